@@ -1,24 +1,78 @@
+#include "attacks.h"
+#include "bitbase.h"
 #include "board_state.h"
 #include "terminal.h"
 #include "chess_engine.h"
+#include "nnue.h"
 
+#include <cstdio>
 #include <cstdlib>
-#include <ctime>
+#include <cstring>
 
 
-// void Move::Print() {
-//     printf("Move %d from %s to %s\n", piece_type, TileContentsArray::GetTileName(src_tile_index), 
-//         TileContentsArray::GetTileName(dest_tile_index));
-// }
-
 enum PlayerType { Cpu, Human } player_types[2];   // Indexed by COLOR_WHITE and COLOR_BLACK
 
-int main(int argc, char* argv[]) {
-    srand(time(NULL));
+static void PrintUsage() {
+    puts("Usage: main [--depth <plies>] [--nodes <count>] [--time <seconds>] [--hash <MB>]\n"
+         "            [--threads <count>] [--attacks magic|pext] [--nnue <network file>]\n"
+         "            [--book <polyglot .bin file>] [--bitbases <directory>]");
+}
 
+int main(int argc, char* argv[]) {
     BoardState board_state = BoardState();
-    ChessEngine engine = ChessEngine(); 
+    ChessEngine engine = ChessEngine();
     Terminal terminal = Terminal();
+    SearchLimits limits;
+    bool depth_given = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--depth") == 0) {
+            limits.depth = strtoul(argv[++i], nullptr, 10);
+            depth_given = true;
+        } else if (i + 1 < argc && strcmp(argv[i], "--nodes") == 0) {
+            limits.nodes = strtoull(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--time") == 0) {
+            limits.seconds = strtod(argv[++i], nullptr);
+        } else if (i + 1 < argc && strcmp(argv[i], "--threads") == 0) {
+            engine.SetThreads(strtoul(argv[++i], nullptr, 10));
+        } else if (i + 1 < argc && strcmp(argv[i], "--hash") == 0) {
+            engine.SetHashSize(strtoul(argv[++i], nullptr, 10));
+        } else if (i + 1 < argc && strcmp(argv[i], "--attacks") == 0) {
+            // Overrides the default (magic) backend, e.g. to compare them
+            const char* name = argv[++i];
+            Attacks::Backend backend = (strcmp(name, "pext") == 0) ? Attacks::Backend::Pext : Attacks::Backend::Magic;
+            if ((strcmp(name, "pext") != 0 && strcmp(name, "magic") != 0) || !Attacks::SetBackend(backend)) {
+                fprintf(stderr, "Attack backend not supported: %s\n", name);
+                return 2;
+            }
+        } else if (i + 1 < argc && strcmp(argv[i], "--nnue") == 0) {
+            const char* path = argv[++i];
+            if (!Nnue::Load(path) || !engine.SetEvaluator(Evaluator::Nnue)) {
+                fprintf(stderr, "Can't load network: %s\n", path);
+                return 2;
+            }
+        } else if (i + 1 < argc && strcmp(argv[i], "--book") == 0) {
+            const char* path = argv[++i];
+            if (!engine.SetBook(path)) {
+                fprintf(stderr, "Can't open book: %s\n", path);
+                return 2;
+            }
+        } else if (i + 1 < argc && strcmp(argv[i], "--bitbases") == 0) {
+            const char* directory = argv[++i];
+            if (!Bitbase::Load(directory)) {
+                fprintf(stderr, "No bitbases found in: %s\n", directory);
+                return 2;
+            }
+        } else {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    // A node or time limit on its own searches as deep as it allows
+    if (!depth_given && (limits.nodes || limits.seconds > 0))
+        limits.depth = 0;
+    engine.SetSearchLimits(limits);
 
     // TODO: a way to quit, other than CTRL-C
     for (int i = 0; i < 20; i ++) {
@@ -28,31 +82,28 @@ int main(int argc, char* argv[]) {
         Move move;
 
         if (player_types[to_move] == PlayerType::Cpu) {
-            move = engine.SelectMove(board_state);
-            //move.Print();
-
-            if (move.captures) {
-                TileContents dest_tile = board_state.GetTile(move.dest_tile_index);
-                move.captured_type = dest_tile.piece_type;
+            move = engine.GetBookMove(board_state);
+            if (!move.IsNull()) {
+                terminal.PrintMessage(("Book move " + Terminal::MoveToText(move)).c_str());
+            } else {
+                SearchResult result = engine.RunSearch(board_state);
+                terminal.PrintSearchResult(result);
+                move = result.best_move;
+            }
+            if (move.IsNull()) {
+                terminal.PrintMessage("No moves");
+                break;
             }
-
         } else {
-            // NOTE: the player move won't have the captures flag set.
-            // Since we're already checking it against a computer generated move that has the flag
-            // set, maybe we can just copy it in during the check...
+            // The player move only has the tiles (and promotion type) set. IsLegalMove fills
+            // in the rest of the flags from the matching generated move.
             move = terminal.GetPlayerMove();
             while (!engine.IsLegalMove(board_state, move)) {
                 terminal.PrintMessage("Invalid move");
                 move = terminal.GetPlayerMove();
             }
-            TileContents src_tile = board_state.GetTile(move.src_tile_index);
-            move.piece_type = src_tile.piece_type;
-
-            TileContents dest_tile = board_state.GetTile(move.dest_tile_index);
-            move.captured_type = dest_tile.piece_type;
-            move.captures = move.captured_type != PieceType::None;
         }
-        
+
         board_state.ApplyMove(move);
     }
 
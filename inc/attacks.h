@@ -0,0 +1,265 @@
+#ifndef ATTACKS_H_DEFINED
+#define ATTACKS_H_DEFINED
+
+#include <array>
+#include <cstdint>
+#include "chess_common.h"
+#include "bitboard.h"
+
+// Precomputed attack sets, usable without a ChessEngine instance.
+//
+// Tables for the leaping pieces (and the between / line tables) are generated at compile time
+// from the Bitboard single step functions.
+//
+// Sliding piece attacks use 'fancy' magic bitboards: the occupancy is masked down to the
+// tiles that can block the slider, multiplied by a per-tile magic number, and shifted down to
+// an index into a table of attack sets shared by all tiles. See:
+// https://www.chessprogramming.org/Magic_Bitboards
+//
+// On x86-64 the slider tables can instead be indexed with the BMI2 PEXT instruction, which
+// extracts the masked occupancy bits directly, without the multiply and shift. Each backend has
+// its own table, filled in its own order, and is chosen at compile time by the template
+// argument of Rook<B> and so on, so that a lookup never tests which backend is in use. Move
+// generation is built for each backend, and picks one per call (see SetBackend); the untemplated
+// functions use the build's static_backend. See: https://www.chessprogramming.org/BMI2#PEXTBitboards
+//
+// Magic is the default even where CPUID reports BMI2, which only decides whether PEXT may be
+// selected: perft backends measured no consistent difference (magic 58.1M vs PEXT 56.5M nps on
+// one machine, 33.6-42.4M vs 34.1-44.8M on another). PEXT is used if asked for, or in a build
+// with -DATTACKS_PEXT (and -mbmi2), which also makes it the static backend. -DATTACKS_MAGIC
+// leaves PEXT out entirely.
+//
+// Attack sets include the first blocker in each direction, regardless of its color.
+#if defined(ATTACKS_PEXT)
+#include <immintrin.h>
+#elif !defined(ATTACKS_MAGIC) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ATTACKS_DISPATCH
+#endif
+
+namespace Attacks {
+
+enum class Backend { Magic, Pext };
+
+#if defined(ATTACKS_PEXT)
+constexpr Backend static_backend = Backend::Pext;
+#else
+constexpr Backend static_backend = Backend::Magic;
+#endif
+
+// Builds the sliding piece tables: the PEXT ones only if the CPU supports it. Safe to call more
+// than once; only the first call does work.
+void Init();
+
+// Whether this build and CPU can use the PEXT backend
+bool PextSupported();
+
+// The backend move generation uses. Returns false (and keeps the current backend) if it isn't
+// supported.
+bool SetBackend(Backend backend);
+Backend GetBackend();
+const char* BackendName(Backend backend);
+
+// With the given backend's tables. Rook<Backend::Pext> and so on must only be used if
+// PextSupported(). (In a build without PEXT, they use the magic tables.)
+template <Backend B> Bitboard Rook(TileIndex index, Bitboard occupied);
+template <Backend B> Bitboard Bishop(TileIndex index, Bitboard occupied);
+template <Backend B> Bitboard Queen(TileIndex index, Bitboard occupied);
+
+// With static_backend
+Bitboard Rook(TileIndex index, Bitboard occupied);
+Bitboard Bishop(TileIndex index, Bitboard occupied);
+Bitboard Queen(TileIndex index, Bitboard occupied);
+
+Bitboard Knight(TileIndex index);
+Bitboard King(TileIndex index);
+
+// Tiles attacked by a pawn of the given color (not the tiles it can push to)
+Bitboard Pawn(Color color, TileIndex index);
+
+// Tiles strictly between a and b, if they share a rank, file or diagonal. Otherwise empty.
+Bitboard Between(TileIndex a, TileIndex b);
+
+// The whole rank, file or diagonal through a and b (edge to edge, including a and b),
+// if they share one. Otherwise empty.
+Bitboard Line(TileIndex a, TileIndex b);
+
+
+/******************************************************************************
+ * Attacks - Compile Time Tables
+ *****************************************************************************/
+using TileTable = std::array<Bitboard, TileIndex::num_tiles>;
+
+// Ordered so that opposite directions differ only in bit 0 of their position
+constexpr Direction all_directions[8] = {
+    Direction::North, Direction::South, Direction::East, Direction::West,
+    Direction::NorthEast, Direction::SouthWest, Direction::SouthEast, Direction::NorthWest
+};
+
+constexpr TileTable MakeKnightTable() {
+    TileTable table{};
+    for (unsigned i = 0; i < TileIndex::num_tiles; i++) {
+        Bitboard b(1ULL << i);
+        table[i] = b.StepNorth().StepNorthEast() | b.StepNorth().StepNorthWest()
+                 | b.StepSouth().StepSouthEast() | b.StepSouth().StepSouthWest()
+                 | b.StepEast().StepNorthEast()  | b.StepEast().StepSouthEast()
+                 | b.StepWest().StepNorthWest()  | b.StepWest().StepSouthWest();
+    }
+    return table;
+}
+
+constexpr TileTable MakeKingTable() {
+    TileTable table{};
+    for (unsigned i = 0; i < TileIndex::num_tiles; i++) {
+        for (Direction dir : all_directions)
+            table[i] |= Bitboard(1ULL << i).Step(dir);
+    }
+    return table;
+}
+
+// Indexed by Color::Black or Color::White, then by tile
+constexpr std::array<TileTable, 2> MakePawnTable() {
+    std::array<TileTable, 2> table{};
+    for (unsigned i = 0; i < TileIndex::num_tiles; i++) {
+        Bitboard b(1ULL << i);
+        table[static_cast<int>(Color::White)][i] = b.StepNorthWest() | b.StepNorthEast();
+        table[static_cast<int>(Color::Black)][i] = b.StepSouthWest() | b.StepSouthEast();
+    }
+    return table;
+}
+
+// Walks every ray from every tile. For each tile b on a ray from a, 'between' gets the tiles
+// walked over so far, and 'line' gets the ray plus its opposite ray.
+constexpr void MakeRayTables(std::array<TileTable, TileIndex::num_tiles>& between,
+        std::array<TileTable, TileIndex::num_tiles>& line) {
+    for (unsigned a = 0; a < TileIndex::num_tiles; a++) {
+        TileTable full_rays{};
+        for (unsigned d = 0; d < 8; d++) {
+            Bitboard b(1ULL << a);
+            while ((b = b.Step(all_directions[d])).GetBits())
+                full_rays[d] |= b;
+        }
+
+        for (unsigned d = 0; d < 8; d++) {
+            Bitboard full_line = full_rays[d] | full_rays[d ^ 1] | Bitboard(1ULL << a);
+            Bitboard walked;
+            Bitboard b(1ULL << a);
+            while ((b = b.Step(all_directions[d])).GetBits()) {
+                unsigned index = __builtin_ctzll(b.GetBits());
+                between[a][index] = walked;
+                line[a][index] = full_line;
+                walked |= b;
+            }
+        }
+    }
+}
+
+constexpr std::array<TileTable, TileIndex::num_tiles> MakeBetweenTable() {
+    std::array<TileTable, TileIndex::num_tiles> between{}, line{};
+    MakeRayTables(between, line);
+    return between;
+}
+
+constexpr std::array<TileTable, TileIndex::num_tiles> MakeLineTable() {
+    std::array<TileTable, TileIndex::num_tiles> between{}, line{};
+    MakeRayTables(between, line);
+    return line;
+}
+
+inline constexpr TileTable knight_table = MakeKnightTable();
+inline constexpr TileTable king_table = MakeKingTable();
+inline constexpr std::array<TileTable, 2> pawn_table = MakePawnTable();
+inline constexpr std::array<TileTable, TileIndex::num_tiles> between_table = MakeBetweenTable();
+inline constexpr std::array<TileTable, TileIndex::num_tiles> line_table = MakeLineTable();
+
+
+/******************************************************************************
+ * Attacks - Inline Function Definitions
+ *****************************************************************************/
+#if defined(ATTACKS_PEXT)
+inline uint64_t Pext(uint64_t bits, uint64_t mask) {
+    return _pext_u64(bits, mask);
+}
+#elif defined(ATTACKS_DISPATCH)
+// Inline assembly rather than the intrinsic, so that the rest of the program needn't be built
+// for BMI2. It is only executed if the CPU supports it.
+inline uint64_t Pext(uint64_t bits, uint64_t mask) {
+    uint64_t result;
+    asm("pextq %2, %1, %0" : "=r"(result) : "r"(bits), "r"(mask));
+    return result;
+}
+#endif
+
+struct Magic {
+    uint64_t mask;          // Tiles which can block the slider (excludes edges of the board)
+    uint64_t magic;
+    Bitboard* attacks;      // This tile's slice of the magic attack table
+    Bitboard* pext_attacks; // Its slice of the PEXT table: the same size, in a different order
+    unsigned shift;         // 64 minus the number of bits in 'mask'
+
+    unsigned Index(uint64_t occupied) const {
+        return static_cast<unsigned>(((occupied & mask) * magic) >> shift);
+    }
+
+    template <Backend B>
+    Bitboard Lookup(uint64_t occupied) const {
+#if defined(ATTACKS_PEXT) || defined(ATTACKS_DISPATCH)
+        if constexpr (B == Backend::Pext)
+            return pext_attacks[Pext(occupied, mask)];
+#endif
+        return attacks[Index(occupied)];
+    }
+};
+
+extern Magic rook_magics[TileIndex::num_tiles];
+extern Magic bishop_magics[TileIndex::num_tiles];
+
+template <Backend B>
+inline Bitboard Rook(TileIndex index, Bitboard occupied) {
+    return rook_magics[index].Lookup<B>(occupied.GetBits());
+}
+
+template <Backend B>
+inline Bitboard Bishop(TileIndex index, Bitboard occupied) {
+    return bishop_magics[index].Lookup<B>(occupied.GetBits());
+}
+
+template <Backend B>
+inline Bitboard Queen(TileIndex index, Bitboard occupied) {
+    return Rook<B>(index, occupied) | Bishop<B>(index, occupied);
+}
+
+inline Bitboard Rook(TileIndex index, Bitboard occupied) {
+    return Rook<static_backend>(index, occupied);
+}
+
+inline Bitboard Bishop(TileIndex index, Bitboard occupied) {
+    return Bishop<static_backend>(index, occupied);
+}
+
+inline Bitboard Queen(TileIndex index, Bitboard occupied) {
+    return Queen<static_backend>(index, occupied);
+}
+
+inline Bitboard Knight(TileIndex index) {
+    return knight_table[index];
+}
+
+inline Bitboard King(TileIndex index) {
+    return king_table[index];
+}
+
+inline Bitboard Pawn(Color color, TileIndex index) {
+    return pawn_table[static_cast<int>(color)][index];
+}
+
+inline Bitboard Between(TileIndex a, TileIndex b) {
+    return between_table[a][b];
+}
+
+inline Bitboard Line(TileIndex a, TileIndex b) {
+    return line_table[a][b];
+}
+
+} // namespace Attacks
+
+#endif // ATTACKS_H_DEFINED
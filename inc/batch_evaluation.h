@@ -0,0 +1,67 @@
+#ifndef BATCH_EVALUATION_H_DEFINED
+#define BATCH_EVALUATION_H_DEFINED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "chess_common.h"
+#include "board_state.h"
+
+// Material and piece-square evaluation of many positions at once, for scoring positions
+// offline (labeling datasets, building books) rather than during search. The score of each
+// position is the same as BoardState::GetEvaluation would give it.
+//
+// Positions are stored as a structure of arrays: one array of bitboards per color and piece
+// type, with an entry per position. Each bitboard is scored a rank at a time, from tables of
+// the summed piece-square scores of every possible rank occupancy. The AVX2 backend scores 8
+// positions per instruction, gathering the rank scores for all 8 together. Building with
+// -DBATCH_EVALUATION_SCALAR leaves it out.
+#if !defined(BATCH_EVALUATION_SCALAR) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BATCH_EVALUATION_AVX2
+#endif
+
+namespace Evaluation {
+
+class PositionBatch {
+public:
+    void Clear();
+    void Reserve(size_t count);
+    void Add(const BoardState& bs);
+    size_t Size() const;
+
+    // Bitboards of one color and piece type, indexed by position
+    const uint64_t* Pieces(Color color, PieceType type) const;
+
+private:
+    std::vector<uint64_t> pieces_[2][6];    // Indexed by Color, then by PieceType
+};
+
+enum class BatchBackend { Scalar, Avx2 };
+
+// Whether this build and CPU can use the AVX2 backend
+bool Avx2Supported();
+
+// The fastest supported backend
+BatchBackend DefaultBatchBackend();
+const char* BatchBackendName(BatchBackend backend);
+
+// Writes the evaluation of each position in batch to scores, which must have room for
+// batch.Size() entries. Returns false (and writes nothing) if the backend isn't supported.
+bool EvaluateBatch(const PositionBatch& batch, int* scores, BatchBackend backend);
+void EvaluateBatch(const PositionBatch& batch, int* scores);
+
+
+/******************************************************************************
+ * PositionBatch - Inline Function Definitions
+ *****************************************************************************/
+inline size_t PositionBatch::Size() const {
+    return pieces_[0][0].size();
+}
+
+inline const uint64_t* PositionBatch::Pieces(Color color, PieceType type) const {
+    return pieces_[static_cast<int>(color)][static_cast<int>(type)].data();
+}
+
+} // namespace Evaluation
+
+#endif // BATCH_EVALUATION_H_DEFINED
@@ -0,0 +1,68 @@
+#ifndef BITBASE_H_DEFINED
+#define BITBASE_H_DEFINED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "chess_common.h"
+
+class BoardState;
+
+// Win/draw bitbases for the endgames of king and one pawn, rook or queen against a lone king.
+// See: https://www.chessprogramming.org/Endgame_Bitbases
+//
+// A position is indexed by the tiles of the strong side's king, the weak side's king and the
+// strong side's piece, and by the side to move: 2^19 positions, one bit each (1 if the strong
+// side wins), so each file is 64 KB. The strong side is white in the index; positions where it
+// is black are mirrored vertically, with the colors swapped. Illegal positions are draws.
+//
+// Generate solves an endgame by retrograde analysis: every position is first classified where
+// it can be (mate, stalemate, the piece captured, a pawn promoted), and then the rest are
+// repeatedly classified from the positions they move to, until a pass changes nothing. A
+// position with the strong side to move wins if any move reaches a win; with the weak side to
+// move, if every move does. Positions still unclassified can't be won. Each pass is split
+// across threads, each reading the last pass's results and writing its own range of this
+// pass's. A pawn that promotes wins if the position with a queen (or a rook, to avoid
+// stalemate) does, so KPK is generated after KQK and KRK.
+//
+// The files are memory mapped by Load, and Probe answers for a BoardState with one of the
+// loaded endgames' material.
+namespace Bitbase {
+
+enum class Endgame { Kpk, Krk, Kqk };
+
+constexpr unsigned num_endgames = 3;
+constexpr uint32_t num_positions = 1 << 19;
+constexpr size_t file_size = num_positions / 8;
+
+// "kpk.bin" and so on
+const char* FileName(Endgame endgame);
+
+// Index of a position, with the strong side (white) to move or not
+uint32_t Index(unsigned strong_king, unsigned weak_king, unsigned piece, bool strong_to_move);
+
+// Solves the endgame with the given number of threads (at least one), and returns its file
+// contents: bit (index % 8) of byte (index / 8) is set if the strong side wins. KPK needs the
+// KQK and KRK results, and generates them if they aren't passed in.
+std::vector<uint8_t> Generate(Endgame endgame, unsigned threads,
+    const std::vector<uint8_t>* kqk = nullptr, const std::vector<uint8_t>* krk = nullptr);
+
+bool Save(const std::vector<uint8_t>& bits, const char* path);
+
+// Maps the files of each endgame found in directory, replacing any already loaded. Returns
+// the number loaded. A file of the wrong size is skipped.
+unsigned Load(const char* directory);
+void Unload();
+bool IsLoaded(Endgame endgame);
+bool AnyLoaded();
+
+// From the point of view of the player to move
+enum class Result { Unknown, Draw, Win, Loss };
+
+// The result of the position, if its material is that of a loaded endgame (kings and one
+// pawn, rook or queen). Otherwise Unknown.
+Result Probe(const BoardState& bs);
+
+} // namespace Bitbase
+
+#endif // BITBASE_H_DEFINED
@@ -32,15 +32,11 @@ public:
     static constexpr uint64_t initial_white_queen_bits = 0x0000000000000008ULL;
     static constexpr uint64_t initial_white_king_bits = 0x0000000000000010ULL;
 
-    // For faster knight attack calculations, shift this knight attack pattern
-    // (for a knight on D4) so that it's centered on the knight we want to generate for.
-    static constexpr uint64_t knight_pattern_d4 = 0x0000142200221400ULL;
-
-    Bitboard(uint64_t bits_ = 0);
+    constexpr Bitboard(uint64_t bits_ = 0);
     Bitboard(TileIndex index);
 
     // Returns the raw bitboard data
-    uint64_t GetBits() const;
+    constexpr uint64_t GetBits() const;
 
     // Returns true if the bit at the given index is set
     bool BitTest(TileIndex index) const;
@@ -52,16 +48,16 @@ public:
     Bitboard& BitClear(TileIndex index);
 
     // Bitwise operators
-    Bitboard operator|(const Bitboard& other) const;
-    Bitboard& operator|=(const Bitboard& other);
+    constexpr Bitboard operator|(const Bitboard& other) const;
+    constexpr Bitboard& operator|=(const Bitboard& other);
 
-    Bitboard operator&(const Bitboard& other) const;
-    Bitboard& operator&=(const Bitboard& other);
+    constexpr Bitboard operator&(const Bitboard& other) const;
+    constexpr Bitboard& operator&=(const Bitboard& other);
 
-    Bitboard operator^(const Bitboard& other) const;
-    Bitboard& operator^=(const Bitboard& other);
+    constexpr Bitboard operator^(const Bitboard& other) const;
+    constexpr Bitboard& operator^=(const Bitboard& other);
 
-    Bitboard operator~() const;
+    constexpr Bitboard operator~() const;
 
     // Finds index of least significant bit that is set. At least one bit must be set.
     TileIndex BitscanForward() const ;
@@ -74,21 +70,24 @@ public:
 
     // Bitboard single step functions: Shift the whole bitboard by one tile in a cardinal 
     // direction, removing pieces that would shift off the edge. Return new bitboard value.
-    Bitboard StepNorth() const;
-    Bitboard StepSouth() const;
-    Bitboard StepEast() const;
-    Bitboard StepWest() const;
-    Bitboard StepNorthWest() const;
-    Bitboard StepNorthEast() const;
-    Bitboard StepSouthWest() const;
-    Bitboard StepSouthEast() const;
+    constexpr Bitboard StepNorth() const;
+    constexpr Bitboard StepSouth() const;
+    constexpr Bitboard StepEast() const;
+    constexpr Bitboard StepWest() const;
+    constexpr Bitboard StepNorthWest() const;
+    constexpr Bitboard StepNorthEast() const;
+    constexpr Bitboard StepSouthWest() const;
+    constexpr Bitboard StepSouthEast() const;
+
+    // Parameterized single step
+    constexpr Bitboard Step(Direction dir) const;
 
     // Implements a generic shift by repeated single steps
-    Bitboard Shift(int ranks, int files) const;
+    constexpr Bitboard Shift(int ranks, int files) const;
 
     // Equals and not equals operators
-    bool operator==(const Bitboard& other) const;
-    bool operator!=(const Bitboard& other) const;
+    constexpr bool operator==(const Bitboard& other) const;
+    constexpr bool operator!=(const Bitboard& other) const;
 
 private:
     uint64_t bits_;
@@ -100,12 +99,12 @@ std::ostream& operator<<(std::ostream& os, const Bitboard& b);
 /******************************************************************************
  * Bitboard - Inline Function Definitions
  *****************************************************************************/
-inline Bitboard::Bitboard(uint64_t x) : bits_(x) {}
+constexpr Bitboard::Bitboard(uint64_t x) : bits_(x) {}
 
 inline Bitboard::Bitboard(TileIndex index)
     : bits_((uint64_t)1 << static_cast<int>(index.value_)) {}
 
-inline uint64_t Bitboard::GetBits() const {
+constexpr uint64_t Bitboard::GetBits() const {
     return bits_;
 }
 
@@ -123,34 +122,34 @@ inline Bitboard& Bitboard::BitClear(TileIndex index) {
     return *this;
 }
 
-inline Bitboard Bitboard::operator|(const Bitboard& other) const {
+constexpr Bitboard Bitboard::operator|(const Bitboard& other) const {
     return Bitboard(bits_ | other.GetBits());
 }
 
-inline Bitboard& Bitboard::operator|=(const Bitboard& other) {
+constexpr Bitboard& Bitboard::operator|=(const Bitboard& other) {
     bits_ |= other.bits_;
     return *this;
 }
 
-inline Bitboard Bitboard::operator&(const Bitboard& other) const {
+constexpr Bitboard Bitboard::operator&(const Bitboard& other) const {
     return Bitboard(bits_ & other.GetBits());
 }
 
-inline Bitboard& Bitboard::operator&=(const Bitboard& other) {
+constexpr Bitboard& Bitboard::operator&=(const Bitboard& other) {
     bits_ &= other.bits_;
     return *this;
 }
 
-inline Bitboard Bitboard::operator^(const Bitboard& other) const {
+constexpr Bitboard Bitboard::operator^(const Bitboard& other) const {
     return Bitboard(bits_ ^ other.GetBits());
 }
 
-inline Bitboard& Bitboard::operator^=(const Bitboard& other) {
+constexpr Bitboard& Bitboard::operator^=(const Bitboard& other) {
     bits_ ^= other.bits_;
     return *this;
 }
 
-inline Bitboard Bitboard::operator~() const {
+constexpr Bitboard Bitboard::operator~() const {
     return Bitboard(~bits_);
 }
 
@@ -170,20 +169,34 @@ inline TileIndex Bitboard::Bitscan(BitscanDirection dir) const {
 }
 
 // Mask out pieces on the A or H file in these funcs so they shift off the board instead of wrapping
-inline Bitboard Bitboard::StepEast() const      { return Bitboard((bits_ & ~h_file_bits) << 1); }
-inline Bitboard Bitboard::StepWest() const      { return Bitboard((bits_ & ~a_file_bits) >> 1); }
+constexpr Bitboard Bitboard::StepEast() const       { return Bitboard((bits_ & ~h_file_bits) << 1); }
+constexpr Bitboard Bitboard::StepWest() const       { return Bitboard((bits_ & ~a_file_bits) >> 1); }
 
-inline Bitboard Bitboard::StepNorthWest() const { return Bitboard((bits_ & ~a_file_bits) << 7); }
-inline Bitboard Bitboard::StepNorthEast() const { return Bitboard((bits_ & ~h_file_bits) << 9); }
-inline Bitboard Bitboard::StepSouthWest() const { return Bitboard((bits_ & ~a_file_bits) >> 9); }
-inline Bitboard Bitboard::StepSouthEast() const { return Bitboard((bits_ & ~h_file_bits) >> 7); }
+constexpr Bitboard Bitboard::StepNorthWest() const  { return Bitboard((bits_ & ~a_file_bits) << 7); }
+constexpr Bitboard Bitboard::StepNorthEast() const  { return Bitboard((bits_ & ~h_file_bits) << 9); }
+constexpr Bitboard Bitboard::StepSouthWest() const  { return Bitboard((bits_ & ~a_file_bits) >> 9); }
+constexpr Bitboard Bitboard::StepSouthEast() const  { return Bitboard((bits_ & ~h_file_bits) >> 7); }
 
 // No need for masking - at the edge of the board, these just shift out to zero.
-inline Bitboard Bitboard::StepNorth() const     { return Bitboard(bits_ << 8); }
-inline Bitboard Bitboard::StepSouth() const     { return Bitboard(bits_ >> 8); }
+constexpr Bitboard Bitboard::StepNorth() const      { return Bitboard(bits_ << 8); }
+constexpr Bitboard Bitboard::StepSouth() const      { return Bitboard(bits_ >> 8); }
+
+constexpr Bitboard Bitboard::Step(Direction dir) const {
+    switch (dir) {
+        case Direction::North:          return StepNorth();
+        case Direction::South:          return StepSouth();
+        case Direction::East:           return StepEast();
+        case Direction::West:           return StepWest();
+        case Direction::NorthEast:      return StepNorthEast();
+        case Direction::NorthWest:      return StepNorthWest();
+        case Direction::SouthEast:      return StepSouthEast();
+        case Direction::SouthWest:      return StepSouthWest();
+    }
+    return Bitboard(0);
+}
 
 
-inline Bitboard Bitboard::Shift(int ranks, int files) const {
+constexpr Bitboard Bitboard::Shift(int ranks, int files) const {
     Bitboard b = *this;
     for ( ; files > 0; files--)
         b = b.StepEast();
@@ -200,11 +213,11 @@ inline Bitboard Bitboard::Shift(int ranks, int files) const {
     return b;
 }
 
-inline bool Bitboard::operator==(const Bitboard& other) const {
+constexpr bool Bitboard::operator==(const Bitboard& other) const {
     return bits_ == other.bits_;
 }
 
-inline bool Bitboard::operator!=(const Bitboard& other) const {
+constexpr bool Bitboard::operator!=(const Bitboard& other) const {
     return !operator==(other);
 }
 
@@ -220,8 +233,8 @@ struct PlayerBitboards {
     // Get a reference to one of the bitboards, by piece type
     Bitboard& GetBitboardByType(PieceType type);
 
-    // Apply the move to the bitboards
-    void MovePiece(Move m);
+    // Move a piece of the given type from src to dest
+    void MovePiece(PieceType type, TileIndex src, TileIndex dest);
 
     // Delete the piece at the given index
     void DeletePiece(TileIndex index);
@@ -1,10 +1,28 @@
 #ifndef BOARD_STATE_H_DEFINED
 #define BOARD_STATE_H_DEFINED
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 #include "chess_common.h"
 #include "bitboard.h"
+#include "evaluation.h"
+
+namespace Nnue { class AccumulatorStack; }
+class PawnHashTable;
+
+// State destroyed by a move, saved by ApplyMove so that the move can be undone.
+struct UndoRecord {
+    PieceType captured_type;                // PieceType::None if the move wasn't a capture
+    CastlingRights prev_castling_rights[2]; // Indexed by Color::White or Color::Black
+    Bitboard prev_en_passant_target;
+    unsigned prev_half_move_counter;
+    uint64_t prev_hash_key;
+    uint64_t prev_pawn_hash_key;
+    Evaluation::Score prev_psqt_score;
+    int prev_game_phase;
+};
 
 // The state of the chess board (also known as a 'position')
 class BoardState {
@@ -14,8 +32,19 @@ public:
     BoardState();
 
     // Initialize the board to the given state, which must be in FEN notation.
-    // TODO: not implemented yet! But the empty string can be passed to get an empty board.
-    BoardState(std::string init_state_fen);
+    // The empty string can be passed to get an empty board. Throws std::invalid_argument
+    // if the string can't be parsed. Nothing is allocated unless it throws, so this is fast
+    // enough for loading large test suites.
+    BoardState(std::string_view init_state_fen);
+
+    // Longest FEN that WriteFen can produce, not counting the null terminator
+    static constexpr size_t max_fen_length = 103;
+
+    // Writes the position in FEN notation to buffer, which must have room for max_fen_length
+    // characters plus a null terminator. Returns the length written. GetFen is the same, but
+    // allocates a string.
+    size_t WriteFen(char* buffer) const;
+    std::string GetFen() const;
 
     enum Color GetPlayerToMove() const;
 
@@ -23,17 +52,64 @@ public:
 
     PlayerBitboards& GetOpponentBitboards();
 
+    const PlayerBitboards& GetBitboards(Color color) const;
+
+    // Tile that a pawn of the player to move could capture en passant (empty if none)
+    Bitboard GetEnPassantTarget() const;
+
+    CastlingRights GetCastlingRights(Color color) const;
+
     // Useful for converting from bitboard representation to array representation of the board.
+    // Both of these are a single load from the mailbox.
     TileContents GetTile(TileIndex index) const;
+    PieceType GetPieceType(TileIndex index) const;
 
     // Useful for test purposes (e.g. adding pieces). Probably doesn't have any use in a game.
     void SetTile(TileIndex index, TileContents tc);
 
-    // Update board state according to m and return true, if m is valid. Else return false.
-    bool ApplyMove(Move m);
+    // Update board state according to m, which must be a legal move in this position (it isn't
+    // checked). The second version saves the state needed to undo the move. Both dispatch once
+    // on the player to move, to a version built for that color.
+    void ApplyMove(Move m);
+    void ApplyMove(Move m, UndoRecord& undo);
+
+    // Restore the board state from before m was applied. m must be the last move applied, and
+    // undo the record that ApplyMove filled in for it. Also pops the NNUE accumulators, which
+    // is why the search uses make/unmake rather than copying the board.
+    void UndoMove(Move m, const UndoRecord& undo);
+
+    // Zobrist key of the position (pieces, side to move, castling rights and en passant file, if
+    // a pawn could capture there).
+    // Maintained incrementally by SetTile, ApplyMove and UndoMove.
+    uint64_t GetHashKey() const;
+
+    // Zobrist key of the pawns alone, for caching pawn structure evaluation
+    uint64_t GetPawnHashKey() const;
 
-    // Return value indicates which player is ahead and by how much. Ex: +1 means white is up a pawn.
-    double GetEvaluation() const;
+    // Recomputes both keys from scratch and compares them with the incremental ones. Building
+    // with DEBUG_HASH_KEYS checks this after every move and undo.
+    bool HashKeysAreConsistent() const;
+
+    // Checks that the mailbox matches the bitboards
+    bool MailboxIsConsistent() const;
+
+    // Recomputes the evaluation terms from scratch and compares them with the incremental
+    // ones. Building with DEBUG_EVALUATION checks this after every move and undo.
+    bool EvaluationIsConsistent() const;
+
+    // While accumulators are attached, ApplyMove and UndoMove push and pop them, and record the
+    // pieces each move changes (see nnue.h). The search attaches its own for the duration of a
+    // search; pass nullptr to detach them.
+    void SetAccumulators(Nnue::AccumulatorStack* accumulators);
+    Nnue::AccumulatorStack* GetAccumulators() const;
+
+    // Return value indicates which player is ahead and by how much, in centipawns. Ex: +100
+    // means white is up a pawn. Maintained incrementally, so this is cheap.
+    int GetEvaluation() const;
+
+    // The same, plus the pawn structure terms (see pawn_structure.h), which are looked up in
+    // (or computed and stored in) pawn_table
+    int GetEvaluation(PawnHashTable& pawn_table) const;
 
 
 private:
@@ -42,10 +118,81 @@ private:
     Bitboard en_passant_target_bitboard;    // Tiles where en passant capture is legal, in this ply
     unsigned ply_counter;                   // Zero indexed (white moves on ply 0, 2, 4...)
 
-    // TODO: implement 50 move rule, which requires the half_move_counter
-    //unsigned half_move_counter;             // Num half turns since the last capture / pawn move. Draw at 100.
-
-    double GetPlayerEvaluation(const PlayerBitboards& pb) const;
+    // TODO: implement 50 move rule (the counter is maintained, but draws aren't detected yet)
+    unsigned half_move_counter;             // Num half turns since the last capture / pawn move. Draw at 100.
+
+    uint64_t hash_key;
+    uint64_t pawn_hash_key;
+
+    Evaluation::Score psqt_score;           // Material plus piece-square scores, from white's view
+    int game_phase;                         // See Evaluation::max_phase
+
+    Nnue::AccumulatorStack* accumulators;   // Not owned. Usually nullptr.
+
+    // Mailbox of the pieces in the bitboards, indexed by tile: PieceType in bits 0-2
+    // (PieceType::None for an empty tile), and Color in bit 3
+    uint8_t piece_on[TileIndex::num_tiles];
+    static constexpr uint8_t mailbox_empty = static_cast<uint8_t>(PieceType::None);
+
+    template <Color Us> void ApplyMoveFor(Move m, UndoRecord& undo);
+    template <Color Us> void UndoMoveFor(Move m, const UndoRecord& undo);
+    void UpdateCastlingRights(TileIndex index);
+    unsigned GetCastlingIndex() const;
+    uint64_t EnPassantHashKey() const;
+    template <Color Us> uint64_t EnPassantHashKey() const;
+    void HashPiece(Color color, PieceType type, TileIndex index);
+    void PieceAdded(Color color, PieceType type, TileIndex index);
+    void PieceRemoved(Color color, PieceType type, TileIndex index);
+    void ComputeScore(Evaluation::Score& score, int& phase) const;
+    void FillMailbox();
+    static uint8_t MailboxPiece(Color color, PieceType type);
+    uint64_t ComputeHashKey() const;
+    uint64_t ComputePawnHashKey() const;
+    static TileContents TileContentsFromFenChar(char c);
 };
 
+
+/******************************************************************************
+ * BoardState - Inline Function Definitions
+ *****************************************************************************/
+inline Color BoardState::GetPlayerToMove() const {
+    // Black moves on odd plies, since the ply count starts at 0.
+    return (ply_counter & 1) ? Color::Black : Color::White;
+}
+
+inline PlayerBitboards& BoardState::GetSelfBitboards() {
+    return bitboards[static_cast<int>(GetPlayerToMove())];
+}
+
+inline PlayerBitboards& BoardState::GetOpponentBitboards() {
+    return bitboards[static_cast<int>(GetPlayerToMove()) ^ 1];
+}
+
+inline const PlayerBitboards& BoardState::GetBitboards(Color color) const {
+    return bitboards[static_cast<int>(color)];
+}
+
+inline Bitboard BoardState::GetEnPassantTarget() const {
+    return en_passant_target_bitboard;
+}
+
+inline Nnue::AccumulatorStack* BoardState::GetAccumulators() const {
+    return accumulators;
+}
+
+inline uint8_t BoardState::MailboxPiece(Color color, PieceType type) {
+    return static_cast<uint8_t>(static_cast<int>(type) | (static_cast<int>(color) << 3));
+}
+
+inline PieceType BoardState::GetPieceType(TileIndex index) const {
+    return static_cast<PieceType>(piece_on[index] & 7);
+}
+
+inline TileContents BoardState::GetTile(TileIndex index) const {
+    uint8_t piece = piece_on[index];
+    if ((piece & 7) == static_cast<int>(PieceType::None))
+        return TileContents();
+    return TileContents(static_cast<Color>(piece >> 3), static_cast<PieceType>(piece & 7));
+}
+
 #endif // BOARD_STATE_H_DEFINED
\ No newline at end of file
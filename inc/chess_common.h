@@ -24,6 +24,10 @@ enum class Color {
     None
 };
 
+inline constexpr Color OtherColor(Color color) {
+    return (color == Color::White) ? Color::Black : Color::White;
+}
+
 enum class Direction {
     North,
     South,
@@ -97,32 +101,67 @@ struct CastlingRights {
     unsigned king_has_moved   : 1;
 };
 
-// TODO: could move some of these fields out to an ExtendedMove structure
-// since it seems they will only be needed for an UndoMove function
-struct Move {
-    Move() : 
-        src_tile_index(0),
-        dest_tile_index(0), 
-        piece_type(PieceType::None), 
-        captured_type(PieceType::None), 
-        promotion_type(PieceType::None),
-        captures(0) {}
-
-    uint8_t src_tile_index;
-    uint8_t dest_tile_index;
-    PieceType piece_type;
-    PieceType captured_type;
-    PieceType promotion_type;
-    CastlingRights prev_castling_rights;
-
-    // During move generation we do not look up the type of piece that would be captured,
-    // since that would waste a lot of time. Instead we just set this flag, and the 'captured_type'
-    // gets set later (when the move is applied)
-    bool captures;
+// A move packed into 16 bits: source tile (bits 0-5), destination tile (bits 6-11), and a
+// 4 bit flag (bits 12-15) describing captures and special moves:
+//
+//   0000  quiet                    1000  promotion to knight  (+1 bishop, +2 rook, +3 queen)
+//   0001  double pawn push         1100  promotion to knight, with capture  (+1, +2, +3 likewise)
+//   0010  king side castle
+//   0011  queen side castle
+//   0100  capture
+//   0101  en passant capture
+//
+// The types of the moving and captured pieces are not stored; they are on the board when the
+// move is applied. Data needed only to undo a move goes in an UndoRecord (see board_state.h).
+class Move {
+public:
+    enum Flag : uint8_t {
+        Quiet = 0,
+        DoublePawnPush = 1,
+        KingCastle = 2,
+        QueenCastle = 3,
+        Capture = 4,
+        EnPassant = 5,
+        Promotion = 8,              // OR with the promoted piece's offset from PieceType::Knight
+        PromotionCapture = 12,      // Likewise
+    };
+
+    Move() : bits_(0) {}
+    Move(unsigned src_tile_index, unsigned dest_tile_index, unsigned flags = Quiet)
+        : bits_(static_cast<uint16_t>(src_tile_index | (dest_tile_index << 6) | (flags << 12))) {}
+
+    // Rebuilds a move from GetBits(), e.g. after storing it in a packed table entry
+    static Move FromBits(uint16_t bits) { Move move; move.bits_ = bits; return move; }
+
+    // The default constructed move (A1 to A1) is never a real move, so it marks 'no move'
+    bool IsNull() const                 { return bits_ == 0; }
+
+    unsigned GetSrcTileIndex() const    { return bits_ & 0x3F; }
+    unsigned GetDestTileIndex() const   { return (bits_ >> 6) & 0x3F; }
+    unsigned GetFlags() const           { return bits_ >> 12; }
+    uint16_t GetBits() const            { return bits_; }
+
+    bool IsCapture() const      { return GetFlags() & Capture; }
+    bool IsPromotion() const    { return GetFlags() & Promotion; }
+    bool IsEnPassant() const    { return GetFlags() == EnPassant; }
+    bool IsCastle() const       { return GetFlags() == KingCastle || GetFlags() == QueenCastle; }
+
+    // Only meaningful if IsPromotion()
+    PieceType GetPromotionType() const {
+        return static_cast<PieceType>(static_cast<int>(PieceType::Knight) + (GetFlags() & 3));
+    }
+
+    bool operator==(const Move& other) const { return bits_ == other.bits_; }
+    bool operator!=(const Move& other) const { return bits_ != other.bits_; }
+
+private:
+    uint16_t bits_;
 };
 
+static_assert(sizeof(Move) == 2, "Move should pack into 16 bits");
+
 // Returns the change in tile index associated with a single step in the given direction.
-inline int TileIndexOffsetFromDirection(Direction dir) {
+constexpr int TileIndexOffsetFromDirection(Direction dir) {
     switch(dir) {
         case Direction::North:          return  8;  break;
         case Direction::South:          return -8;  break;
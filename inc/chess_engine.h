@@ -3,49 +3,181 @@
 
 #include "chess_common.h"
 #include "board_state.h"
-#include <vector>
+#include "attacks.h"
+#include "move_list.h"
+#include "pawn_structure.h"
+#include "polyglot_book.h"
+#include "search.h"
+#include "transposition_table.h"
+
+#include <cstddef>
+#include <memory>
 
 class ChessEngine {
 public:
-    ChessEngine() {}
+    static constexpr size_t default_hash_size_mb = 16;
+
+    // Which moves GenerateMoves produces. Captures include en passant and capturing
+    // promotions; quiet moves include the other promotions and castling.
+    enum class GenType { All, Captures, Quiets };
 
+    ChessEngine() : gen_type_(GenType::All), legal_(false), king_index_(0), threads_(1),
+        hash_size_mb_(default_hash_size_mb), evaluator_(Evaluator::Classical), book_random_state_(1) {
+        Attacks::Init();
+    }
+
+    // Plays a book move if there is one (see SetBook), otherwise searches the position (see
+    // search.h) and returns the best move found
     Move SelectMove(BoardState& bs);
 
+    // Same as SelectMove, but returns the score, principal variation and search statistics.
+    // With more than one thread, the nodes are the total searched by all threads.
+    SearchResult RunSearch(BoardState& bs);
+
+    void SetSearchLimits(const SearchLimits& limits);
+
+    // Number of search threads (Lazy SMP). The result and limits are those of the first
+    // thread; the others only fill the shared transposition table. A node limited search is
+    // only reproducible with one thread.
+    void SetThreads(unsigned threads);
+
+    // Transposition table size. The table is allocated by the first search, so an engine
+    // used only for move generation never allocates it.
+    void SetHashSize(size_t size_mb);
+
+    // How the search scores positions. Returns false (and keeps the current evaluator) if
+    // Evaluator::Nnue is asked for without a network loaded.
+    bool SetEvaluator(Evaluator evaluator);
+    Evaluator GetEvaluator() const { return evaluator_; }
+
+    // Opens a Polyglot opening book (see polyglot_book.h), closing any book already open.
+    // Returns false if it can't be opened.
+    bool SetBook(const char* path);
+
+    // One of the book's moves for the position, picked at random in proportion to their
+    // weights. The null move if there is no book or it has no moves for the position.
+    Move GetBookMove(BoardState& bs);
+
+    // Pawn structure cache for the classical evaluation. Allocated on first use, and kept
+    // from one search to the next. Each helper search thread has its own.
+    PawnHashTable& GetPawnHashTable();
+
     // Generates all legal moves for the current position and returns true
-    // if the given move matches one of them.
+    // if the given move matches one of them (by source, destination and promotion type).
+    // If so, the move is updated with the flags of the matching move.
     // -- Useful for validating human player inputs and for testing purposes, 
     // but very slow -- the CPU player should never call this function.
-    bool IsLegalMove(BoardState& bs, Move move);
+    bool IsLegalMove(BoardState& bs, Move& move);
+
+    // Pieces of either color which attack index, with sliders blocked by occupied. Passing an
+    // occupancy other than the board's shows the attackers behind pieces which are removed,
+    // e.g. when exchanging on a tile.
+    Bitboard AttackersTo(const BoardState& bs, TileIndex index, Bitboard occupied) const;
+
+    // Whether any piece of by_color attacks index. Returns at the first attack found.
+    bool IsSquareAttacked(const BoardState& bs, TileIndex index, Color by_color) const;
 
-    bool IsOwnKingInCheck(BoardState& bs);
+    bool IsOwnKingInCheck(const BoardState& bs) const;
+
+    // Generates the legal moves for the player to move, into the given (cleared) list. The
+    // pieces giving check and the pinned pieces are found once, up front; then pinned pieces
+    // only move along their pin ray, only check evasions are generated when in check, and the
+    // king doesn't move onto an attacked tile. See:
+    // https://www.chessprogramming.org/Move_Generation#Legal
+    //
+    // The search generates captures and quiet moves in separate calls (see MovePicker), so
+    // that nodes which cut off on a capture never generate quiet moves.
+    void GenerateMoves(BoardState& bs, MoveList& moves, GenType type = GenType::All);
+
+    // Generates pseudo-legal moves: the same moves, and also those which leave the mover's
+    // king attacked (or castle out of or through check). The king may be missing.
+    void GeneratePseudoLegalMoves(BoardState& bs, MoveList& moves);
+
+    // The pieces giving check, as found by the last call to GenerateMoves
+    Bitboard GetCheckers() const { return checkers_; }
+
+    // Counts the leaf nodes of the move tree to the given depth (performance test). Used to
+    // validate move generation against known results, and to measure its speed.
+    // Walks the tree with ApplyMove / UndoMove on the one BoardState.
+    uint64_t Perft(BoardState& bs, unsigned depth);
+
+    // Same as Perft, but copies the BoardState for each move instead of undoing it. For
+    // comparing the speed of the two strategies.
+    uint64_t PerftCopyMake(const BoardState& bs, unsigned depth);
+
+    // Same as Perft, but generates pseudo-legal moves and filters out the illegal ones by
+    // making each move and testing whether the mover's king is attacked. For comparing the
+    // speed of legal generation.
+    uint64_t PerftPseudoLegal(BoardState& bs, unsigned depth);
 
 private:
 
-    void GenerateMoves(BoardState& bs);
-    void GeneratePawnMoves(BoardState& bs);
-    void GenerateKnightMoves(BoardState& bs);
-    void GenerateBishopMoves(BoardState& bs);
-    void GenerateRookMoves(BoardState& bs);
-    void GenerateQueenMoves(BoardState& bs);
-    void GenerateKingMoves(BoardState& bs);
-    void EnqueueMoves(BoardState&bs, PieceType type, TileIndex source, 
-        Bitboard attacks, Bitboard quiet_moves);
+    // Generation is built for each color, so that the pawn directions, promotion and castling
+    // ranks are compile time constants, and for each slider attack backend (see attacks.h).
+    // The untemplated version dispatches on the player to move and the backend, once per node.
+    void GenerateAllMoves(BoardState& bs, MoveList& moves);
+    template <Color Us, Attacks::Backend B> void GenerateAllMoves(BoardState& bs, MoveList& moves);
+    template <Color Us, Attacks::Backend B> void FindCheckersAndPins(BoardState& bs);
+
+    template <Attacks::Backend B> Bitboard AttackersTo(const BoardState& bs, TileIndex index, Bitboard occupied) const;
+    template <Attacks::Backend B> bool IsSquareAttacked(const BoardState& bs, TileIndex index, Color by_color) const;
+
+    // Tiles attacked by the given player's pieces, with sliders blocked by occupied
+    template <Color Them, Attacks::Backend B> Bitboard GetAttackedTiles(BoardState& bs, Bitboard occupied) const;
+
+    // Whether an en passant capture leaves the king attacked. Two pieces leave the rank, so
+    // the pin mask can't tell.
+    template <Color Us, Attacks::Backend B> bool EnPassantExposesKing(BoardState& bs, TileIndex src, TileIndex dest) const;
+
+    // Restricts a piece's destinations to the check mask, and to its pin ray if it is pinned
+    Bitboard LegalDestinations(TileIndex index, Bitboard destinations) const;
+
+    template <Color Us, Attacks::Backend B> void GeneratePawnMoves(BoardState& bs, MoveList& moves);
+    template <Color Us> void GenerateKnightMoves(BoardState& bs, MoveList& moves);
+    template <Color Us, Attacks::Backend B> void GenerateBishopMoves(BoardState& bs, MoveList& moves);
+    template <Color Us, Attacks::Backend B> void GenerateRookMoves(BoardState& bs, MoveList& moves);
+    template <Color Us, Attacks::Backend B> void GenerateQueenMoves(BoardState& bs, MoveList& moves);
+    template <Color Us, Attacks::Backend B> void EnqueuePawnMoves(BoardState& bs, MoveList& moves, Bitboard destinations,
+        int offset, unsigned flags);
+    template <Color Us, Attacks::Backend B> void GenerateKingMoves(BoardState& bs, MoveList& moves);
+    template <Color Us> void GenerateCastlingMoves(BoardState& bs, MoveList& moves);
+    void EnqueueMoves(MoveList& moves, TileIndex source, Bitboard attacks, Bitboard quiet_moves);
 
 
     Bitboard GetEmptyBoardRayAttacks(TileIndex index, Direction dir) const;
     Bitboard GetRayAttacks(TileIndex index, Direction dir) const;
-    Bitboard GetRookAttacks(TileIndex index) const;
-    Bitboard GetBishopAttacks(TileIndex index) const;
-    Bitboard GetQueenAttacks(TileIndex index) const;
+    template <Attacks::Backend B> Bitboard GetRookAttacks(TileIndex index) const;
+    template <Attacks::Backend B> Bitboard GetBishopAttacks(TileIndex index) const;
+    template <Attacks::Backend B> Bitboard GetQueenAttacks(TileIndex index) const;
     Bitboard GetKnightAttacks(TileIndex index) const;
     Bitboard GetKingAttacks(TileIndex index) const;
 
     // Initialized each time GenerateMoves is called
-    std::vector<Move> move_list_;
     Bitboard targets_;
     Bitboard friendlies_;
     Bitboard empty_tiles_;
     Bitboard occupied_tiles_;
+    Bitboard capture_targets_;      // targets_, or empty if captures aren't generated
+    Bitboard quiet_targets_;        // empty_tiles_, or empty if quiet moves aren't generated
+    GenType gen_type_;
+
+    // Initialized each time GenerateMoves is called. For pseudo-legal generation, these
+    // don't restrict any moves.
+    bool legal_;
+    unsigned king_index_;
+    Bitboard checkers_;
+    Bitboard pinned_;
+    Bitboard check_mask_;       // Destinations that block or capture a single checker
+    Bitboard king_danger_;      // Attacked tiles, seen through our king
+
+    SearchLimits search_limits_;
+    unsigned threads_;
+    size_t hash_size_mb_;
+    Evaluator evaluator_;
+    std::unique_ptr<TranspositionTable> tt_;
+    std::unique_ptr<PawnHashTable> pawn_table_;
+    std::unique_ptr<PolyglotBook> book_;
+    uint64_t book_random_state_;    // XorShift64Star state, for picking book moves
 };
 
 
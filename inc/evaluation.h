@@ -0,0 +1,187 @@
+#ifndef EVALUATION_H_DEFINED
+#define EVALUATION_H_DEFINED
+
+#include <array>
+#include <cstdint>
+#include "chess_common.h"
+
+// Material and piece-square scores, in centipawns from white's point of view. Each piece has
+// a middlegame and an endgame score, which BoardState sums incrementally as pieces move. The
+// evaluation tapers between the two sums by the game phase: the non-pawn material left on the
+// board. See: https://www.chessprogramming.org/Tapered_Eval
+//
+// The piece-square tables are from the Simplified Evaluation Function:
+// https://www.chessprogramming.org/Simplified_Evaluation_Function
+namespace Evaluation {
+
+struct Score {
+    int32_t mg;     // Middlegame
+    int32_t eg;     // Endgame
+
+    constexpr Score operator+(Score other) const { return { mg + other.mg, eg + other.eg }; }
+    constexpr Score operator-(Score other) const { return { mg - other.mg, eg - other.eg }; }
+    constexpr Score operator-() const { return { -mg, -eg }; }
+    Score& operator+=(Score other) { mg += other.mg; eg += other.eg; return *this; }
+    Score& operator-=(Score other) { mg -= other.mg; eg -= other.eg; return *this; }
+    constexpr bool operator==(Score other) const { return mg == other.mg && eg == other.eg; }
+};
+
+// Game phase is 24 with all the minor and major pieces on the board, and 0 with none
+constexpr int max_phase = 24;
+constexpr int phase_weights[6] = { 0, 1, 1, 2, 4, 0 };     // Indexed by PieceType
+
+// Material plus piece-square score of one piece, negated for black pieces
+Score PieceScore(Color color, PieceType type, TileIndex index);
+
+int PhaseWeight(PieceType type);
+
+// Blends the middlegame and endgame scores by the phase (clamped to max_phase)
+int Taper(Score score, int phase);
+
+
+/******************************************************************************
+ * Evaluation - Compile Time Tables
+ *****************************************************************************/
+// Kings aren't counted, since both sides always have one
+constexpr Score piece_values[6] = {
+    { 100, 100 }, { 300, 300 }, { 310, 310 }, { 520, 520 }, { 900, 900 }, { 0, 0 }
+};
+
+using SquareTable = std::array<int, TileIndex::num_tiles>;
+
+// Laid out as seen from white's side of the board: A8 is the top left, and H1 the bottom right
+constexpr SquareTable pawn_mg_table = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+     50,  50,  50,  50,  50,  50,  50,  50,
+     10,  10,  20,  30,  30,  20,  10,  10,
+      5,   5,  10,  25,  25,  10,   5,   5,
+      0,   0,   0,  20,  20,   0,   0,   0,
+      5,  -5, -10,   0,   0, -10,  -5,   5,
+      5,  10,  10, -20, -20,  10,  10,   5,
+      0,   0,   0,   0,   0,   0,   0,   0,
+};
+
+// In the endgame, advancing passers matters more than controlling the center
+constexpr SquareTable pawn_eg_table = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+    100, 100, 100, 100, 100, 100, 100, 100,
+     60,  60,  60,  60,  60,  60,  60,  60,
+     35,  35,  35,  35,  35,  35,  35,  35,
+     20,  20,  20,  20,  20,  20,  20,  20,
+     10,  10,  10,  10,  10,  10,  10,  10,
+      0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+};
+
+constexpr SquareTable knight_table = {
+    -50, -40, -30, -30, -30, -30, -40, -50,
+    -40, -20,   0,   0,   0,   0, -20, -40,
+    -30,   0,  10,  15,  15,  10,   0, -30,
+    -30,   5,  15,  20,  20,  15,   5, -30,
+    -30,   0,  15,  20,  20,  15,   0, -30,
+    -30,   5,  10,  15,  15,  10,   5, -30,
+    -40, -20,   0,   5,   5,   0, -20, -40,
+    -50, -40, -30, -30, -30, -30, -40, -50,
+};
+
+constexpr SquareTable bishop_table = {
+    -20, -10, -10, -10, -10, -10, -10, -20,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -10,   0,   5,  10,  10,   5,   0, -10,
+    -10,   5,   5,  10,  10,   5,   5, -10,
+    -10,   0,  10,  10,  10,  10,   0, -10,
+    -10,  10,  10,  10,  10,  10,  10, -10,
+    -10,   5,   0,   0,   0,   0,   5, -10,
+    -20, -10, -10, -10, -10, -10, -10, -20,
+};
+
+constexpr SquareTable rook_table = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+      5,  10,  10,  10,  10,  10,  10,   5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+      0,   0,   0,   5,   5,   0,   0,   0,
+};
+
+constexpr SquareTable queen_table = {
+    -20, -10, -10,  -5,  -5, -10, -10, -20,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -10,   0,   5,   5,   5,   5,   0, -10,
+     -5,   0,   5,   5,   5,   5,   0,  -5,
+      0,   0,   5,   5,   5,   5,   0,  -5,
+    -10,   5,   5,   5,   5,   5,   0, -10,
+    -10,   0,   5,   0,   0,   0,   0, -10,
+    -20, -10, -10,  -5,  -5, -10, -10, -20,
+};
+
+constexpr SquareTable king_mg_table = {
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -20, -30, -30, -40, -40, -30, -30, -20,
+    -10, -20, -20, -20, -20, -20, -20, -10,
+     20,  20,   0,   0,   0,   0,  20,  20,
+     20,  30,  10,   0,   0,  10,  30,  20,
+};
+
+constexpr SquareTable king_eg_table = {
+    -50, -40, -30, -20, -20, -30, -40, -50,
+    -30, -20, -10,   0,   0, -10, -20, -30,
+    -30, -10,  20,  30,  30,  20, -10, -30,
+    -30, -10,  30,  40,  40,  30, -10, -30,
+    -30, -10,  30,  40,  40,  30, -10, -30,
+    -30, -10,  20,  30,  30,  20, -10, -30,
+    -30, -30,   0,   0,   0,   0, -30, -30,
+    -50, -30, -30, -30, -30, -30, -30, -50,
+};
+
+using PieceSquareTable = std::array<std::array<Score, TileIndex::num_tiles>, 6>;
+
+// Indexed by PieceType, then by tile (A1 = 0) for a white piece. A black piece on a tile
+// scores the negation of a white piece on the same tile mirrored vertically (tile ^ 56).
+constexpr PieceSquareTable MakePieceSquareTable() {
+    const SquareTable* mg_tables[6] = { &pawn_mg_table, &knight_table, &bishop_table,
+        &rook_table, &queen_table, &king_mg_table };
+    const SquareTable* eg_tables[6] = { &pawn_eg_table, &knight_table, &bishop_table,
+        &rook_table, &queen_table, &king_eg_table };
+
+    PieceSquareTable table{};
+    for (unsigned type = 0; type < 6; type++) {
+        for (unsigned i = 0; i < TileIndex::num_tiles; i++) {
+            // The source tables start at A8, so flip the rank
+            table[type][i] = piece_values[type]
+                + Score{ (*mg_tables[type])[i ^ 56], (*eg_tables[type])[i ^ 56] };
+        }
+    }
+    return table;
+}
+
+inline constexpr PieceSquareTable piece_square_table = MakePieceSquareTable();
+
+
+/******************************************************************************
+ * Evaluation - Inline Function Definitions
+ *****************************************************************************/
+inline Score PieceScore(Color color, PieceType type, TileIndex index) {
+    if (color == Color::White)
+        return piece_square_table[static_cast<int>(type)][index];
+    return -piece_square_table[static_cast<int>(type)][index ^ 56];
+}
+
+inline int PhaseWeight(PieceType type) {
+    return phase_weights[static_cast<int>(type)];
+}
+
+inline int Taper(Score score, int phase) {
+    if (phase > max_phase)
+        phase = max_phase;      // Possible after promotions
+    return (score.mg * phase + score.eg * (max_phase - phase)) / max_phase;
+}
+
+} // namespace Evaluation
+
+#endif // EVALUATION_H_DEFINED
@@ -0,0 +1,18 @@
+#ifndef MAPPED_FILE_H_DEFINED
+#define MAPPED_FILE_H_DEFINED
+
+#include <cstddef>
+#include <cstdint>
+
+// Read-only memory mapping of a whole file, for the data files (opening book, bitbases) that
+// are read in place rather than loaded. The mapping stays valid after the file is closed, and
+// processes on the same host share the page cached copy.
+
+// Maps the file at path, and sets size to its length. Returns nullptr if it can't be opened or
+// mapped, or is empty.
+const uint8_t* MapFile(const char* path, size_t& size);
+
+// Unmaps a mapping returned by MapFile, given the size it set
+void UnmapFile(const uint8_t* data, size_t size);
+
+#endif // MAPPED_FILE_H_DEFINED
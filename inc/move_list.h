@@ -0,0 +1,72 @@
+#ifndef MOVE_LIST_H_DEFINED
+#define MOVE_LIST_H_DEFINED
+
+#include "chess_common.h"
+
+// Fixed capacity list of moves, with inline storage so it can live on the stack (one per
+// search ply) without any heap allocation. No legal chess position has more than 218 moves.
+class MoveList {
+public:
+    static constexpr unsigned max_moves = 256;
+
+    MoveList() : size_(0) {}
+
+    void PushBack(Move move);
+    void Clear();
+
+    unsigned Size() const;
+    bool Empty() const;
+
+    Move& operator[](unsigned i);
+    const Move& operator[](unsigned i) const;
+
+    Move* begin();
+    Move* end();
+    const Move* begin() const;
+    const Move* end() const;
+
+private:
+    // In an anonymous union so that constructing a list doesn't construct every element
+    union {
+        Move moves_[max_moves];
+    };
+    unsigned size_;
+};
+
+
+/******************************************************************************
+ * MoveList - Inline Function Definitions
+ *****************************************************************************/
+inline void MoveList::PushBack(Move move) {
+    assert(size_ < max_moves);
+    moves_[size_++] = move;
+}
+
+inline void MoveList::Clear() {
+    size_ = 0;
+}
+
+inline unsigned MoveList::Size() const {
+    return size_;
+}
+
+inline bool MoveList::Empty() const {
+    return size_ == 0;
+}
+
+inline Move& MoveList::operator[](unsigned i) {
+    assert(i < size_);
+    return moves_[i];
+}
+
+inline const Move& MoveList::operator[](unsigned i) const {
+    assert(i < size_);
+    return moves_[i];
+}
+
+inline Move* MoveList::begin()                { return moves_; }
+inline Move* MoveList::end()                  { return moves_ + size_; }
+inline const Move* MoveList::begin() const    { return moves_; }
+inline const Move* MoveList::end() const      { return moves_ + size_; }
+
+#endif // MOVE_LIST_H_DEFINED
@@ -0,0 +1,57 @@
+#ifndef MOVE_PICKER_H_DEFINED
+#define MOVE_PICKER_H_DEFINED
+
+#include "chess_common.h"
+#include "board_state.h"
+#include "move_list.h"
+
+class ChessEngine;
+
+// Hands out the moves of a search node one at a time, generating them in stages so that a
+// node which cuts off early doesn't pay for moves it never searches:
+//   1. The hash move, from the transposition table
+//   2. Captures, by MVV-LVA: most valuable victim first, then least valuable attacker
+//   3. Quiet moves, in generation order, only once the captures are used up
+// See: https://www.chessprogramming.org/Move_Ordering
+class MovePicker {
+public:
+    // hash_move may be null. The board must not be changed between calls to Next, except by
+    // moves which are undone again.
+    MovePicker(ChessEngine& engine, BoardState& bs, Move hash_move);
+
+    // Captures only (stage 2), for the quiescence search
+    MovePicker(ChessEngine& engine, BoardState& bs);
+
+    // Returns a null move once every legal move has been returned
+    Move Next();
+
+    // Whether the player to move is in check. Known once the captures have been generated,
+    // which is always before Next first returns a null move.
+    bool InCheck() const;
+
+private:
+    enum class Stage { HashMove, GenerateCaptures, Captures, GenerateQuiets, Quiets, Done };
+
+    // The table stores full keys, so a hash move is from this position and legal, barring a
+    // key collision. It is only played if it is among the generated moves, so that a collision
+    // can't corrupt the board. The list it is found in is kept for its own stage.
+    bool HashMoveIsGenerated();
+    void GenerateCaptures();
+    void GenerateQuiets();
+    int MvvLvaScore(Move move) const;
+
+    ChessEngine& engine_;
+    BoardState& bs_;
+    Move hash_move_;
+    Stage stage_;
+    bool captures_only_;
+    bool in_check_;
+
+    MoveList moves_;            // Captures
+    MoveList quiet_moves_;
+    bool quiets_generated_;
+    unsigned next_;
+    int scores_[MoveList::max_moves];
+};
+
+#endif // MOVE_PICKER_H_DEFINED
@@ -0,0 +1,165 @@
+#ifndef NNUE_H_DEFINED
+#define NNUE_H_DEFINED
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include "chess_common.h"
+
+class BoardState;
+
+// Efficiently updatable neural network (NNUE) evaluation, an alternative to the classical
+// material and piece-square evaluation. See: https://www.chessprogramming.org/NNUE
+//
+// The inputs are HalfKP features: for each side's point of view, the tile of that side's king
+// together with the color, type and tile of one other (non-king) piece. Black's point of view
+// is mirrored vertically, so that both sides see their own pieces as white pieces. The first
+// layer (the feature transformer) sums the weights of the active features into an accumulator
+// of transformed_size int16 values per side. A move changes only a few features, so
+// ApplyMove updates the accumulator by adding and subtracting just those weights, unless the
+// king moved, which changes every feature of its side.
+//
+// The accumulators of the side to move and the other side, clamped to 0..127, are the 8-bit
+// input of two small dense layers with int8 weights and a single output neuron, scaled to
+// centipawns from the point of view of the player to move.
+//
+// Inference has scalar, SSE (SSSE3) and AVX2 versions, which give identical results. The
+// fastest one the CPU supports is picked when the network is loaded. Building with
+// -DNNUE_SCALAR leaves out the vector versions.
+#if !defined(NNUE_SCALAR) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define NNUE_SIMD
+#endif
+
+namespace Nnue {
+
+constexpr unsigned num_king_tiles = 64;
+constexpr unsigned num_piece_features = 10 * 64;   // Own and opponent pawns to queens, by tile
+constexpr unsigned num_features = num_king_tiles * num_piece_features;
+constexpr unsigned transformed_size = 256;
+constexpr unsigned hidden1_size = 32;
+constexpr unsigned hidden2_size = 32;
+
+// Dense layer outputs are shifted down by this before being clamped, and the output neuron
+// is divided by output_scale to give centipawns
+constexpr int weight_shift = 6;
+constexpr int output_scale = 16;
+
+// Network file contents, in this order, with no padding between fields. All values are little
+// endian.
+struct alignas(64) Network {
+    static constexpr char magic[8] = { 'C', 'H', 'E', 'S', 'S', 'N', 'N', '1' };
+
+    int16_t feature_biases[transformed_size];
+    int16_t feature_weights[num_features][transformed_size];
+
+    int32_t hidden1_biases[hidden1_size];
+    int8_t hidden1_weights[hidden1_size][2 * transformed_size];   // Player to move's half first
+
+    int32_t hidden2_biases[hidden2_size];
+    int8_t hidden2_weights[hidden2_size][hidden1_size];
+
+    int32_t output_bias;
+    int8_t output_weights[hidden2_size];
+};
+
+enum class Backend { Scalar, Sse, Avx2 };
+
+// Reads a network file: the magic bytes, then the Network fields. Returns false (and keeps the
+// current network, if any) if the file can't be read or is the wrong size.
+bool Load(const char* path);
+bool Save(const char* path);
+
+// Fills the network with small pseudo-random weights, for testing and timing without a
+// trained network. Its evaluation is meaningless.
+void InitRandom(uint64_t seed);
+
+bool IsLoaded();
+
+// Frees the network
+void Unload();
+
+bool BackendSupported(Backend backend);
+bool SetBackend(Backend backend);
+Backend GetBackend();
+const char* BackendName(Backend backend);
+
+// Feature index of a piece, from perspective's point of view with its king on king_tile
+unsigned FeatureIndex(Color perspective, unsigned king_tile, Color color, PieceType type, unsigned tile);
+
+
+// A piece added to or removed from the board by a move
+struct DirtyPiece {
+    Color color;
+    PieceType type;
+    uint8_t tile;
+    bool added;
+};
+
+struct alignas(64) Accumulator {
+    // A move changes at most: the moving piece twice, a promoted pawn twice, and a captured
+    // piece or castling rook
+    static constexpr unsigned max_dirty = 6;
+
+    int16_t values[2][transformed_size];    // Indexed by perspective Color
+    bool computed[2];
+    unsigned num_dirty;
+    DirtyPiece dirty[max_dirty];            // Changes from the previous accumulator
+};
+
+// One accumulator per ply of the line being searched. While a stack is attached to a
+// BoardState, ApplyMove pushes an accumulator and records the pieces it changes, and UndoMove
+// pops it. Accumulators are only computed when a position is evaluated, from the nearest
+// computed one below them (or from scratch, after a king move).
+class AccumulatorStack {
+public:
+    static constexpr unsigned max_depth = 256;
+
+    AccumulatorStack();
+
+    // Forgets all accumulators, so that the next evaluation computes one from scratch
+    void Reset();
+
+    void Push();
+    void Pop();
+    void PieceChanged(Color color, PieceType type, unsigned tile, bool added);
+
+    // Brings the top accumulator up to date with bs, which must be the position it is for
+    const Accumulator& Update(const BoardState& bs);
+
+private:
+    std::vector<Accumulator> entries_;
+    unsigned top_;
+};
+
+// Score of the position in centipawns, from the point of view of the player to move. A
+// network must be loaded, and accumulators attached to bs.
+int Evaluate(const BoardState& bs, AccumulatorStack& accumulators);
+
+// Same, but computes the accumulators from scratch
+int EvaluateFromScratch(const BoardState& bs);
+
+
+/******************************************************************************
+ * AccumulatorStack - Inline Function Definitions
+ *****************************************************************************/
+inline void AccumulatorStack::Push() {
+    assert(top_ + 1 < max_depth);
+    Accumulator& entry = entries_[++top_];
+    entry.computed[0] = entry.computed[1] = false;
+    entry.num_dirty = 0;
+}
+
+inline void AccumulatorStack::Pop() {
+    assert(top_ > 0);
+    top_--;
+}
+
+inline void AccumulatorStack::PieceChanged(Color color, PieceType type, unsigned tile, bool added) {
+    Accumulator& entry = entries_[top_];
+    assert(entry.num_dirty < Accumulator::max_dirty);
+    entry.dirty[entry.num_dirty++] = DirtyPiece{ color, type, static_cast<uint8_t>(tile), added };
+}
+
+} // namespace Nnue
+
+#endif // NNUE_H_DEFINED
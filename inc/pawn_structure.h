@@ -0,0 +1,108 @@
+#ifndef PAWN_STRUCTURE_H_DEFINED
+#define PAWN_STRUCTURE_H_DEFINED
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "evaluation.h"
+
+// Pawn structure terms, computed set-wise from the two sides' pawn bitboards: each term is a
+// handful of shifts and masks over all the pawns at once, then a population count. See:
+// https://www.chessprogramming.org/Pawn_Structure
+//
+//  * Doubled: a pawn with another pawn of its own color in front of it on the same file
+//  * Isolated: a pawn with no pawns of its own color on the neighbouring files
+//  * Backward: a pawn whose stop tile is attacked by an enemy pawn, and which no pawn of its
+//    own color can ever defend (none are level with or behind it on the neighbouring files).
+//    Isolated pawns aren't also counted as backward.
+//  * Blocked: a pawn whose stop tile holds another pawn, of either color
+//  * Passed: the front pawn of a file, with no enemy pawns in front of it on its own or the
+//    neighbouring files. The bonus grows as it advances.
+namespace Evaluation {
+
+constexpr Score doubled_pawn_score = { -10, -25 };
+constexpr Score isolated_pawn_score = { -10, -15 };
+constexpr Score backward_pawn_score = { -8, -12 };
+constexpr Score blocked_pawn_score = { -4, -8 };
+
+// Indexed by rank, counted from the pawn's own side of the board
+constexpr Score passed_pawn_scores[8] = {
+    { 0, 0 }, { 0, 5 }, { 5, 10 }, { 10, 20 }, { 20, 35 }, { 35, 60 }, { 55, 90 }, { 0, 0 }
+};
+
+// Sum of the pawn structure terms, from white's point of view
+Score PawnStructureScore(uint64_t white_pawns, uint64_t black_pawns);
+
+} // namespace Evaluation
+
+
+// Pawn structure scores cached by BoardState::GetPawnHashKey. Pawns move far less often than
+// other pieces, so most positions the search evaluates share their pawns with one already
+// scored.
+//
+// Each search thread has its own table (see ChessEngine), so unlike the transposition table
+// it needs no protection from concurrent writes. Entries are always replaced.
+class PawnHashTable {
+public:
+    // Big enough that the misses are mostly pawn structures met for the first time: bench 5 hits
+    // 91.6% with this size, and only 92.0% with 64 times as many entries
+    static constexpr size_t default_num_entries = 1 << 16;
+
+    // The number of entries is rounded down to a power of two (at least one)
+    explicit PawnHashTable(size_t num_entries = default_num_entries);
+
+    void Clear();
+    size_t GetNumEntries() const;
+
+    // Pawn structure score of the pawns, which have the given pawn hash key: from the table if
+    // it has them, otherwise computed and stored
+    Evaluation::Score Probe(uint64_t key, uint64_t white_pawns, uint64_t black_pawns);
+
+    // Counts of probes, and of those that found their key, since the table was created or the
+    // counts reset
+    uint64_t GetProbes() const;
+    uint64_t GetHits() const;
+    void ResetCounts();
+
+private:
+    struct Entry {
+        uint64_t key;
+        Evaluation::Score score;
+    };
+
+    std::unique_ptr<Entry[]> entries_;
+    size_t num_entries_;
+    uint64_t probes_;
+    uint64_t hits_;
+};
+
+
+/******************************************************************************
+ * PawnHashTable - Inline Function Definitions
+ *****************************************************************************/
+inline Evaluation::Score PawnHashTable::Probe(uint64_t key, uint64_t white_pawns, uint64_t black_pawns) {
+    Entry& entry = entries_[key & (num_entries_ - 1)];
+    probes_++;
+    if (entry.key == key) {
+        hits_++;
+        return entry.score;
+    }
+
+    entry.key = key;
+    entry.score = Evaluation::PawnStructureScore(white_pawns, black_pawns);
+    return entry.score;
+}
+
+inline size_t PawnHashTable::GetNumEntries() const {
+    return num_entries_;
+}
+
+inline uint64_t PawnHashTable::GetProbes() const {
+    return probes_;
+}
+
+inline uint64_t PawnHashTable::GetHits() const {
+    return hits_;
+}
+
+#endif // PAWN_STRUCTURE_H_DEFINED
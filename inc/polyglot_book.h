@@ -0,0 +1,85 @@
+#ifndef POLYGLOT_BOOK_H_DEFINED
+#define POLYGLOT_BOOK_H_DEFINED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "chess_common.h"
+#include "board_state.h"
+
+class ChessEngine;
+
+// Read-only Polyglot opening book (.bin). See:
+// http://hgm.nubati.net/book_format.html
+//
+// The file is a sorted array of 16 byte big endian entries: the position's Polyglot key, a
+// move, a weight and a learning value. Positions with several book moves have several
+// consecutive entries. The file is memory mapped rather than read, so opening it costs
+// nothing up front, and engine processes on the same host share the one page cached copy. A
+// lookup is a binary search on the key, and touches only the pages it reads.
+//
+// Polyglot keys are a Zobrist hash like the engine's own, but with the published Random64
+// table of 781 keys (polyglot_random64.h).
+
+class PolyglotBook {
+public:
+    struct Entry {
+        uint64_t key;
+        uint16_t move;      // Polyglot encoding: see DecodeMove
+        uint16_t weight;
+        uint32_t learn;
+    };
+
+    static constexpr size_t entry_size = 16;
+
+    PolyglotBook();
+    ~PolyglotBook();
+    PolyglotBook(const PolyglotBook&) = delete;
+    PolyglotBook& operator=(const PolyglotBook&) = delete;
+
+    // Maps the file, closing any book already open. Returns false if it can't be mapped, or
+    // isn't a whole number of entries.
+    bool Open(const char* path);
+    void Close();
+    bool IsOpen() const;
+    size_t Size() const;
+
+    // Entry by index, in file (key) order
+    Entry GetEntry(size_t index) const;
+
+    // Appends the entries for key to entries, and returns how many there were
+    size_t Probe(uint64_t key, std::vector<Entry>& entries) const;
+
+    // Polyglot key of the position
+    static uint64_t Key(const BoardState& bs);
+
+    // The legal move in bs for a Polyglot move, or the null move if it isn't legal. Polyglot
+    // encodes castling as the king capturing its own rook.
+    static Move DecodeMove(ChessEngine& engine, BoardState& bs, uint16_t move);
+
+    // Picks one of key's book moves that is legal in bs, with probability in proportion to
+    // its weight, using random (uniform over all 64 bit values) to choose. Moves of weight 0
+    // are never picked. Returns the null move if there is none.
+    Move PickMove(ChessEngine& engine, BoardState& bs, uint64_t key, uint64_t random) const;
+
+    // Same, with the position's own key
+    Move PickMove(ChessEngine& engine, BoardState& bs, uint64_t random) const;
+
+private:
+    const unsigned char* data_;     // The mapping, or nullptr
+    size_t size_;                   // In entries
+};
+
+
+/******************************************************************************
+ * PolyglotBook - Inline Function Definitions
+ *****************************************************************************/
+inline bool PolyglotBook::IsOpen() const {
+    return data_ != nullptr;
+}
+
+inline size_t PolyglotBook::Size() const {
+    return size_;
+}
+
+#endif // POLYGLOT_BOOK_H_DEFINED
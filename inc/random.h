@@ -0,0 +1,17 @@
+#ifndef RANDOM_H_DEFINED
+#define RANDOM_H_DEFINED
+
+#include <cstdint>
+
+// Fast pseudo-random numbers (xorshift64*), for choices which only need to vary, such as
+// picking book moves or generating test data. state must not be zero. The high bits are the
+// best: take a number in a range from those. See:
+// https://vigna.di.unimi.it/ftp/papers/xorshift.pdf
+inline uint64_t XorShift64Star(uint64_t& state) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
+
+#endif // RANDOM_H_DEFINED
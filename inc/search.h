@@ -0,0 +1,131 @@
+#ifndef SEARCH_H_DEFINED
+#define SEARCH_H_DEFINED
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "chess_common.h"
+#include "board_state.h"
+#include "nnue.h"
+#include "pawn_structure.h"
+#include "transposition_table.h"
+
+class ChessEngine;
+
+// Scores are in centipawns, from the point of view of the player to move. Mate scores count
+// down from mate_score by the number of plies to the mate, so that shorter mates score higher.
+constexpr int mate_score = 32000;
+constexpr int infinite_score = mate_score + 1;
+constexpr unsigned max_search_ply = 64;
+
+inline bool IsMateScore(int score) {
+    return score >= mate_score - static_cast<int>(max_search_ply)
+        || score <= -mate_score + static_cast<int>(max_search_ply);
+}
+
+// The search stops at whichever limit it reaches first. Zero means no limit, but at least one
+// of the limits should be set.
+struct SearchLimits {
+    unsigned depth = 4;
+    uint64_t nodes = 0;     // Deterministic: the same search always stops at the same node
+    double seconds = 0;     // Wall clock time
+};
+
+// How the search scores positions. Nnue needs a network to be loaded (see nnue.h).
+enum class Evaluator { Classical, Nnue };
+
+struct SearchResult {
+    Move best_move;
+    int score = 0;
+    unsigned depth = 0;         // Of the last completed iteration
+    std::vector<Move> pv;       // Principal variation, starting with best_move
+    uint64_t nodes = 0;
+    double seconds = 0;
+
+    // Pawn hash table lookups by the classical evaluation, and how many found their pawns
+    // already scored. Counted by the main search thread only.
+    uint64_t pawn_hash_probes = 0;
+    uint64_t pawn_hash_hits = 0;
+};
+
+// Negamax search with alpha-beta pruning, over a single BoardState which is updated with
+// ApplyMove / UndoMove. Positions are scored by BoardState::GetEvaluation, with the pawn
+// structure cached in the engine's pawn hash table, or by the NNUE network, whose
+// accumulators the search attaches to the board while it runs. See:
+// https://www.chessprogramming.org/Alpha-Beta
+//
+// The search is iteratively deepened: depth 1, 2, 3... each ordered by the hash moves left by
+// the one before. The result is from the last iteration that completed. An iteration that
+// hits the time or node limit is abandoned (except the first, so there is always a move), and
+// a new iteration isn't started if it is predicted to overrun the time limit.
+//
+// Moves are searched in the order MovePicker gives them: the hash move, then captures, then
+// quiet moves.
+//
+// At depth 0 a quiescence search plays out captures until the position is quiet, so that a
+// leaf isn't scored in the middle of an exchange. The player to move may 'stand pat' on the
+// static evaluation instead of capturing, unless in check: then every evasion is searched,
+// so that a mate at the horizon is scored as one.
+// See: https://www.chessprogramming.org/Quiescence_Search
+//
+// A position with no legal moves is scored as mate if the player to move is in check, and as
+// a draw otherwise. When endgame bitbases are loaded (see bitbase.h), positions they show to
+// be drawn are scored as draws without searching, and wins score above any material advantage.
+//
+// For a multi-threaded (Lazy SMP) search, several Search objects run at once on their own
+// copies of the board, each with its own engine for move generation, sharing only the
+// transposition table. Helper threads pass a thread_id (which staggers their iterations, so
+// they don't all search the same depth at once) and a stop signal, which they poll at every
+// node. See: https://www.chessprogramming.org/Lazy_SMP
+class Search {
+public:
+    // The engine is used for move generation and its evaluation settings; the transposition
+    // table may be shared with other searches
+    Search(ChessEngine& engine, TranspositionTable& tt, unsigned thread_id = 0,
+        const std::atomic<bool>* stop_signal = nullptr);
+
+    // bs is restored to its original state when the search returns. The caller starts each
+    // new search of the table with TranspositionTable::NewSearch.
+    SearchResult Run(BoardState& bs, const SearchLimits& limits);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Added to the evaluation of a position a bitbase says is won
+    static constexpr int bitbase_win_score = 2000;
+
+    int Negamax(BoardState& bs, int depth, unsigned ply, int alpha, int beta);
+    int Quiescence(BoardState& bs, unsigned ply, int alpha, int beta);
+    int Evaluate(BoardState& bs);
+    void UpdatePv(unsigned ply, Move move);
+    bool ShouldStop();
+    double SecondsElapsed() const;
+
+    // Mate scores are stored relative to the node, rather than the root, in the table
+    static int ScoreToTable(int score, unsigned ply);
+    static int ScoreFromTable(int score, unsigned ply);
+
+    ChessEngine& engine_;
+    TranspositionTable& tt_;
+    unsigned thread_id_;
+    const std::atomic<bool>* stop_signal_;
+    uint64_t nodes_;
+
+    SearchLimits limits_;
+    Evaluator evaluator_;
+    std::unique_ptr<Nnue::AccumulatorStack> accumulators_;     // Only allocated for Nnue
+    PawnHashTable* pawn_table_;                                 // The engine's
+    bool use_bitbases_;                                         // Whether any are loaded
+    Clock::time_point start_;
+    bool can_stop_;             // False during the first iteration
+    bool stopped_;
+
+    // Triangular PV table: pv_[ply] is the best line found from ply, pv_length_[ply] long
+    Move pv_[max_search_ply + 1][max_search_ply + 1];
+    unsigned pv_length_[max_search_ply + 1];
+};
+
+#endif // SEARCH_H_DEFINED
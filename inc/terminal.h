@@ -1,17 +1,23 @@
 #ifndef TERMINAL_H_DEFINED
 #define TERMINAL_H_DEFINED
 
+#include <string>
+
 #include "board_state.h"
+#include "search.h"
 
 class Terminal {
 public:
     void PrintBoard(const BoardState& bs);
     Move GetPlayerMove();
     void PrintMessage(const char* msg);
+    void PrintSearchResult(const SearchResult& result);
+    static std::string MoveToText(Move move);
 
 private:
     void PrintTileFromTileContents(TileContents tc);
     int TileIndexFromText(char file, char rank);
+    int PromotionFromText(char piece);
 };
 
 
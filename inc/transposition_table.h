@@ -0,0 +1,136 @@
+#ifndef TRANSPOSITION_TABLE_H_DEFINED
+#define TRANSPOSITION_TABLE_H_DEFINED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "chess_common.h"
+
+// Search results cached by position (Zobrist) key, shared by all search threads without locks.
+//
+// The table is an array of 64 byte buckets, each one cache line holding four entries, so a
+// probe or store touches a single cache line. An entry is two 64 bit words: the packed data,
+// and the key XORed with the data. A reader recomputes the key from the two words it loaded,
+// so a torn entry (written by two threads at once) fails to match and is treated as a miss,
+// instead of returning one position's data for another. See:
+// https://www.chessprogramming.org/Shared_Hash_Table#Lockless
+//
+// Entries are replaced by depth and age: a store goes to the entry with the same key if there
+// is one, otherwise to the entry with the lowest depth, counting entries from earlier searches
+// as shallower.
+class TranspositionTable {
+public:
+    // How the stored score relates to the true score of the position
+    enum class Bound : uint8_t {
+        None,
+        Exact,
+        Lower,      // Failed high: the true score is at least this
+        Upper       // Failed low: the true score is at most this
+    };
+
+    struct Entry {
+        Move move;          // Best (or refutation) move, or the null move if none is known
+        int16_t score;
+        uint8_t depth;
+        Bound bound;
+    };
+
+    static constexpr unsigned entries_per_bucket = 4;
+
+    // The size is rounded down to a power of two number of buckets (at least one)
+    explicit TranspositionTable(size_t size_mb);
+
+    // Reallocates (and clears) the table. Not safe while a search is running.
+    void Resize(size_t size_mb);
+    void Clear();
+
+    size_t GetSizeBytes() const;
+
+    // Starts a new search, so that entries from earlier searches age and get replaced first
+    void NewSearch();
+
+    // Returns true and fills in entry if the key is in the table
+    bool Probe(uint64_t key, Entry& entry) const;
+
+    // A null move keeps the move already stored for the same key, if any
+    void Store(uint64_t key, Move move, int score, unsigned depth, Bound bound);
+
+    // Permille of the sampled entries written in the current search
+    unsigned GetHashfull() const;
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> key_xor_data;
+        std::atomic<uint64_t> data;
+    };
+
+    struct alignas(64) Bucket {
+        Slot slots[entries_per_bucket];
+    };
+
+    // Packed data layout:
+    //   bits 0-15   move
+    //   bits 16-31  score
+    //   bits 32-39  depth
+    //   bits 40-41  bound
+    //   bits 42-47  age (the search generation, modulo 64)
+    static constexpr unsigned age_bits = 6;
+    static constexpr unsigned age_mask = (1 << age_bits) - 1;
+
+    static uint64_t Pack(Move move, int score, unsigned depth, Bound bound, unsigned age);
+    static Entry Unpack(uint64_t data);
+    static unsigned AgeOf(uint64_t data);
+
+    Bucket& GetBucket(uint64_t key) const;
+
+    std::unique_ptr<Bucket[]> buckets_;
+    size_t num_buckets_;
+    unsigned age_;
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == 8, "Slots must be two plain words");
+
+
+/******************************************************************************
+ * TranspositionTable - Inline Function Definitions
+ *****************************************************************************/
+inline TranspositionTable::Bucket& TranspositionTable::GetBucket(uint64_t key) const {
+    return buckets_[key & (num_buckets_ - 1)];
+}
+
+inline uint64_t TranspositionTable::Pack(Move move, int score, unsigned depth, Bound bound, unsigned age) {
+    return static_cast<uint64_t>(move.GetBits())
+         | static_cast<uint64_t>(static_cast<uint16_t>(score)) << 16
+         | static_cast<uint64_t>(depth & 0xFF) << 32
+         | static_cast<uint64_t>(bound) << 40
+         | static_cast<uint64_t>(age & age_mask) << 42;
+}
+
+inline TranspositionTable::Entry TranspositionTable::Unpack(uint64_t data) {
+    Entry entry;
+    entry.move = Move::FromBits(static_cast<uint16_t>(data));
+    entry.score = static_cast<int16_t>(data >> 16);
+    entry.depth = static_cast<uint8_t>(data >> 32);
+    entry.bound = static_cast<Bound>((data >> 40) & 3);
+    return entry;
+}
+
+inline unsigned TranspositionTable::AgeOf(uint64_t data) {
+    return (data >> 42) & age_mask;
+}
+
+inline bool TranspositionTable::Probe(uint64_t key, Entry& entry) const {
+    const Bucket& bucket = GetBucket(key);
+    for (const Slot& slot : bucket.slots) {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        if ((slot.key_xor_data.load(std::memory_order_relaxed) ^ data) == key) {
+            entry = Unpack(data);
+            return entry.bound != Bound::None;
+        }
+    }
+    return false;
+}
+
+#endif // TRANSPOSITION_TABLE_H_DEFINED
@@ -0,0 +1,100 @@
+#ifndef ZOBRIST_H_DEFINED
+#define ZOBRIST_H_DEFINED
+
+#include <cstdint>
+#include "chess_common.h"
+#include "bitboard.h"
+
+// Random keys for Zobrist hashing. A position's key is the XOR of the keys for each piece on
+// its tile, the castling rights, the en passant file (if any), and the side to move (if black),
+// so a move updates the key by XORing out what it removes and XORing in what it adds. See:
+// https://www.chessprogramming.org/Zobrist_Hashing
+//
+// The keys are generated at compile time, from a fixed seed, so they are the same in every build.
+namespace Zobrist {
+
+// Castling rights are hashed as a 4 bit index of the rights which are still available
+constexpr unsigned white_king_side = 1;
+constexpr unsigned white_queen_side = 2;
+constexpr unsigned black_king_side = 4;
+constexpr unsigned black_queen_side = 8;
+constexpr unsigned num_castling_indices = 16;
+
+uint64_t Piece(Color color, PieceType type, TileIndex index);
+uint64_t Castling(unsigned castling_index);
+
+// Zero if there is no en passant target, so this can be XORed in unconditionally
+uint64_t EnPassant(Bitboard en_passant_target);
+
+uint64_t BlackToMove();
+
+
+/******************************************************************************
+ * Zobrist - Compile Time Tables
+ *****************************************************************************/
+struct Keys {
+    uint64_t pieces[2][6][TileIndex::num_tiles];    // Indexed by Color, PieceType, then tile
+    uint64_t castling[num_castling_indices];
+    uint64_t en_passant_file[8];
+    uint64_t black_to_move;
+};
+
+// https://prng.di.unimi.it/splitmix64.c
+constexpr uint64_t SplitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+constexpr Keys MakeKeys() {
+    Keys keys{};
+    uint64_t state = 0x5A0B0C2153ULL;
+
+    for (auto& color : keys.pieces)
+        for (auto& type : color)
+            for (uint64_t& key : type)
+                key = SplitMix64(state);
+
+    // No rights available hashes to zero, and the other combinations are built from one key
+    // per right, so losing a right is always the same XOR
+    uint64_t right_keys[4] = { SplitMix64(state), SplitMix64(state), SplitMix64(state), SplitMix64(state) };
+    for (unsigned i = 0; i < num_castling_indices; i++) {
+        for (unsigned bit = 0; bit < 4; bit++) {
+            if (i & (1 << bit))
+                keys.castling[i] ^= right_keys[bit];
+        }
+    }
+
+    for (uint64_t& key : keys.en_passant_file)
+        key = SplitMix64(state);
+    keys.black_to_move = SplitMix64(state);
+    return keys;
+}
+
+inline constexpr Keys keys = MakeKeys();
+
+
+/******************************************************************************
+ * Zobrist - Inline Function Definitions
+ *****************************************************************************/
+inline uint64_t Piece(Color color, PieceType type, TileIndex index) {
+    return keys.pieces[static_cast<int>(color)][static_cast<int>(type)][index];
+}
+
+inline uint64_t Castling(unsigned castling_index) {
+    return keys.castling[castling_index];
+}
+
+inline uint64_t EnPassant(Bitboard en_passant_target) {
+    uint64_t bits = en_passant_target.GetBits();
+    return bits ? keys.en_passant_file[__builtin_ctzll(bits) & 7] : 0;
+}
+
+inline uint64_t BlackToMove() {
+    return keys.black_to_move;
+}
+
+} // namespace Zobrist
+
+#endif // ZOBRIST_H_DEFINED
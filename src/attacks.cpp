@@ -0,0 +1,180 @@
+#include "attacks.h"
+
+namespace Attacks {
+
+Magic rook_magics[TileIndex::num_tiles];
+Magic bishop_magics[TileIndex::num_tiles];
+
+namespace {
+
+// Found by a random search over sparse 64-bit numbers: each maps every blocker subset of its
+// tile to a table slot without a destructive collision.
+constexpr uint64_t rook_magic_numbers[TileIndex::num_tiles] = {
+    0x1080004008801020ULL, 0x0840092002C03000ULL, 0x1900200010400900ULL, 0x0880100008000480ULL,
+    0x4200100420080200ULL, 0x8100020100080400ULL, 0x0200040110886200ULL, 0x0200008040220411ULL,
+    0x0404800084400220ULL, 0x0000401000402000ULL, 0x0086001081220440ULL, 0x0408800800100280ULL,
+    0x000A001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL, 0x0442000102105084ULL,
+    0x9080010020804100ULL, 0x0040404000201009ULL, 0x0000808010002009ULL, 0x2200090021D00100ULL,
+    0x0008008008040080ULL, 0x0004004002010040ULL, 0x0011040008015042ULL, 0x00000A0001768104ULL,
+    0x0000800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL, 0x1000100080080080ULL,
+    0x0442000A00049020ULL, 0x2100040080020080ULL, 0x0800120400900148ULL, 0x0010040A00128541ULL,
+    0x2800804000800030ULL, 0x1010002000400041ULL, 0x4000200011004100ULL, 0x0610008410800800ULL,
+    0x0400802402800800ULL, 0xC100020080800400ULL, 0x0002000802000401ULL, 0x0182085882000401ULL,
+    0x0220204000808000ULL, 0x2860100040024022ULL, 0x0001002004110040ULL, 0x99101042000A0020ULL,
+    0x0004080004008080ULL, 0x0010040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+    0x0088403882010200ULL, 0x0820400080210100ULL, 0x0110910040A00300ULL, 0x0801100280080480ULL,
+    0x0242009008200600ULL, 0x1002000489500200ULL, 0x0040800200010080ULL, 0x0091800041000080ULL,
+    0x0000209300488001ULL, 0x04C1002414824001ULL, 0x020020000B001041ULL, 0x7000100004200901ULL,
+    0x8002002004100802ULL, 0x30010002084C0007ULL, 0x0888221800813004ULL, 0x4000002840840112ULL
+};
+
+constexpr uint64_t bishop_magic_numbers[TileIndex::num_tiles] = {
+    0xA010041108003100ULL, 0x006082020A002900ULL, 0x6810010619200000ULL, 0x08281A0520000408ULL,
+    0x0001104001000400ULL, 0x0018901008048400ULL, 0x00040A0210245280ULL, 0x000200210808A402ULL,
+    0x9140048410821200ULL, 0x0800091010820041ULL, 0x20504804832202C0ULL, 0x0100091401081000ULL,
+    0x8021011140000012ULL, 0x0810020804450400ULL, 0x208B0542109008A2ULL, 0x0080084A08040204ULL,
+    0x0040E2A80811244CULL, 0x2505022008008108ULL, 0x0430220100420040ULL, 0x010A040420220040ULL,
+    0x1105000290400000ULL, 0x0093001200822120ULL, 0x4000A62048043004ULL, 0x280120048A015004ULL,
+    0x006090002A020814ULL, 0x44042000240800D0ULL, 0x01102800040A4400ULL, 0x1004080080220040ULL,
+    0x0001001011004024ULL, 0x0010044000805040ULL, 0x0914041200820100ULL, 0x0004821012821480ULL,
+    0x0024040500C05021ULL, 0x0088611002080200ULL, 0x0116080A00040020ULL, 0x4000020080080080ULL,
+    0x2450450140840040ULL, 0x0000880201484100ULL, 0x0222020404020092ULL, 0x8081110600002E00ULL,
+    0x2842101105000801ULL, 0x1100809008001025ULL, 0x00020202221C0400ULL, 0x0422014022009020ULL,
+    0x0210046102100C00ULL, 0xC004008082029102ULL, 0x00AA461801101200ULL, 0x0404080080201108ULL,
+    0x020542108C205002ULL, 0x0410544804100100ULL, 0x0040910841100000ULL, 0x0400200042021100ULL,
+    0x00004204850400C0ULL, 0x0200100410A42102ULL, 0x1040020801210102ULL, 0x0805040410420000ULL,
+    0x2884804130100200ULL, 0x800C262201242000ULL, 0x1058000194108800ULL, 0x0014221054420204ULL,
+    0x0104000012A02200ULL, 0x0200881003300100ULL, 0x0140400202840100ULL, 0x0402020801010201ULL
+};
+
+// Each rook tile has 2^10 to 2^12 blocker subsets, each bishop tile 2^5 to 2^9.
+constexpr unsigned kRookTableSize = 102400;
+constexpr unsigned kBishopTableSize = 5248;
+Bitboard attack_table[kRookTableSize + kBishopTableSize];
+Bitboard pext_attack_table[kRookTableSize + kBishopTableSize];     // Untouched unless PEXT is supported
+
+using StepFunction = Bitboard (Bitboard::*)() const;
+
+const StepFunction rook_steps[4] = {
+    &Bitboard::StepNorth, &Bitboard::StepSouth, &Bitboard::StepEast, &Bitboard::StepWest
+};
+
+const StepFunction bishop_steps[4] = {
+    &Bitboard::StepNorthEast, &Bitboard::StepNorthWest, &Bitboard::StepSouthEast, &Bitboard::StepSouthWest
+};
+
+// Slow ray walk, used only to fill the tables.
+Bitboard SlidingAttacks(TileIndex index, Bitboard occupied, const StepFunction (&steps)[4]) {
+    Bitboard attacks;
+    for (StepFunction step : steps) {
+        Bitboard b(index);
+        while ((b = (b.*step)()).GetBits()) {
+            attacks |= b;
+            if ((b & occupied).GetBits())
+                break;
+        }
+    }
+    return attacks;
+}
+
+// The last tile of each ray can't block anything, so it is left out of the mask.
+Bitboard BlockerMask(TileIndex index, const StepFunction (&steps)[4]) {
+    Bitboard mask;
+    for (StepFunction step : steps) {
+        Bitboard b(index);
+        Bitboard next = (b.*step)();
+        while (((next.*step)()).GetBits()) {
+            mask |= next;
+            next = (next.*step)();
+        }
+    }
+    return mask;
+}
+
+Backend backend = static_backend;
+
+// Portable PEXT, for filling the tables: packs the bits of 'bits' selected by 'mask' into the
+// low bits of the result.
+uint64_t SoftwarePext(uint64_t bits, uint64_t mask) {
+    uint64_t result = 0;
+    for (uint64_t bit = 1; mask; bit <<= 1, mask &= mask - 1) {
+        if (bits & mask & -mask)
+            result |= bit;
+    }
+    return result;
+}
+
+// Fills the magic table, and the PEXT table too if with_pext. The slices are at the same
+// offsets in both.
+size_t InitMagics(Magic (&magics)[TileIndex::num_tiles], const uint64_t (&magic_numbers)[TileIndex::num_tiles],
+        const StepFunction (&steps)[4], size_t offset, bool with_pext) {
+    for (unsigned i = 0; i < TileIndex::num_tiles; i++) {
+        Magic& m = magics[i];
+        m.mask = BlockerMask(i, steps).GetBits();
+        m.magic = magic_numbers[i];
+        m.shift = 64 - __builtin_popcountll(m.mask);
+        m.attacks = attack_table + offset;
+        m.pext_attacks = pext_attack_table + offset;
+
+        // Enumerate all subsets of the mask (Carry-Rippler trick)
+        uint64_t subset = 0;
+        do {
+            Bitboard attacks = SlidingAttacks(i, subset, steps);
+            Bitboard& entry = m.attacks[m.Index(subset)];
+            assert(entry.GetBits() == 0 || entry == attacks);
+            entry = attacks;
+            if (with_pext)
+                m.pext_attacks[SoftwarePext(subset, m.mask)] = attacks;
+            subset = (subset - m.mask) & m.mask;
+        } while (subset);
+
+        offset += 1ULL << (64 - m.shift);
+    }
+    return offset;
+}
+
+bool InitTables() {
+    bool with_pext = PextSupported();
+    size_t end = InitMagics(rook_magics, rook_magic_numbers, rook_steps, 0, with_pext);
+    end = InitMagics(bishop_magics, bishop_magic_numbers, bishop_steps, end, with_pext);
+    assert(end == kRookTableSize + kBishopTableSize);
+    (void)end;
+    return true;
+}
+
+} // namespace
+
+void Init() {
+    static const bool initialized = InitTables();
+    (void)initialized;
+}
+
+bool PextSupported() {
+#if defined(ATTACKS_PEXT)
+    return true;
+#elif defined(ATTACKS_DISPATCH)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2");
+#else
+    return false;
+#endif
+}
+
+bool SetBackend(Backend new_backend) {
+    Init();
+    if (new_backend == Backend::Pext && !PextSupported())
+        return false;
+    backend = new_backend;
+    return true;
+}
+
+Backend GetBackend() {
+    Init();
+    return backend;
+}
+
+const char* BackendName(Backend backend) {
+    return (backend == Backend::Pext) ? "pext" : "magic";
+}
+
+} // namespace Attacks
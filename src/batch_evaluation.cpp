@@ -0,0 +1,220 @@
+#include "batch_evaluation.h"
+#include "evaluation.h"
+
+#if defined(BATCH_EVALUATION_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace Evaluation {
+
+namespace {
+
+// Middlegame and endgame scores packed into one int32, so that a single add (or gather) handles
+// both. The endgame score is the low 16 bits, and the middlegame score is the rest, less a
+// borrow if the endgame score is negative. Both sums stay well inside 16 bits.
+int32_t PackScore(Score score) {
+    return static_cast<int32_t>(static_cast<uint32_t>(score.mg) << 16) + score.eg;
+}
+
+int32_t UnpackMg(int32_t packed) {
+    return static_cast<int32_t>(static_cast<uint32_t>(packed) + 0x8000) >> 16;
+}
+
+int32_t UnpackEg(int32_t packed) {
+    return static_cast<int16_t>(packed & 0xFFFF);
+}
+
+// Packed score of every occupancy of every rank, for each color and piece type. Indexed by
+// Color, PieceType, rank, and then the rank's byte of the bitboard.
+struct RankTables {
+    int32_t scores[2][6][8][256];
+};
+
+RankTables MakeRankTables() {
+    RankTables tables;
+    for (Color color : { Color::Black, Color::White }) {
+        for (int type = 0; type < 6; type++) {
+            for (unsigned rank = 0; rank < 8; rank++) {
+                for (unsigned occupancy = 0; occupancy < 256; occupancy++) {
+                    Score sum{ 0, 0 };
+                    for (unsigned file = 0; file < 8; file++) {
+                        if (occupancy & (1 << file))
+                            sum += PieceScore(color, static_cast<PieceType>(type), TileIndex(rank, file));
+                    }
+                    tables.scores[static_cast<int>(color)][type][rank][occupancy] = PackScore(sum);
+                }
+            }
+        }
+    }
+    return tables;
+}
+
+const RankTables& GetRankTables() {
+    static const RankTables tables = MakeRankTables();
+    return tables;
+}
+
+void EvaluateScalar(const PositionBatch& batch, int* scores, size_t begin, const RankTables& tables) {
+    for (size_t i = begin; i < batch.Size(); i++) {
+        int32_t packed = 0;
+        int phase = 0;
+        for (Color color : { Color::Black, Color::White }) {
+            for (int type = 0; type < 6; type++) {
+                uint64_t bits = batch.Pieces(color, static_cast<PieceType>(type))[i];
+                if (!bits)
+                    continue;
+
+                const int32_t (&ranks)[8][256] = tables.scores[static_cast<int>(color)][type];
+                for (unsigned rank = 0; rank < 8; rank++)
+                    packed += ranks[rank][(bits >> (8 * rank)) & 0xFF];
+                phase += PhaseWeight(static_cast<PieceType>(type)) * __builtin_popcountll(bits);
+            }
+        }
+        scores[i] = Taper(Score{ UnpackMg(packed), UnpackEg(packed) }, phase);
+    }
+}
+
+#if defined(BATCH_EVALUATION_AVX2)
+// Sum of the rank scores of four ranks, with the ranks' bits in each byte of the lanes of bits
+__attribute__((target("avx2")))
+inline __m256i GatherRankScores(__m256i bits, const int32_t* ranks) {
+    const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+    __m256i sum = _mm256_i32gather_epi32(ranks, _mm256_and_si256(bits, byte_mask), 4);
+    sum = _mm256_add_epi32(sum, _mm256_i32gather_epi32(ranks + 256,
+        _mm256_and_si256(_mm256_srli_epi32(bits, 8), byte_mask), 4));
+    sum = _mm256_add_epi32(sum, _mm256_i32gather_epi32(ranks + 512,
+        _mm256_and_si256(_mm256_srli_epi32(bits, 16), byte_mask), 4));
+    return _mm256_add_epi32(sum, _mm256_i32gather_epi32(ranks + 768, _mm256_srli_epi32(bits, 24), 4));
+}
+
+// Population count of each 32-bit lane, by looking up each nibble
+__attribute__((target("avx2")))
+inline __m256i Popcount32(__m256i bits) {
+    const __m256i nibble_counts = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+    __m256i byte_counts = _mm256_add_epi8(
+        _mm256_shuffle_epi8(nibble_counts, _mm256_and_si256(bits, nibble_mask)),
+        _mm256_shuffle_epi8(nibble_counts, _mm256_and_si256(_mm256_srli_epi16(bits, 4), nibble_mask)));
+    return _mm256_madd_epi16(_mm256_maddubs_epi16(byte_counts, _mm256_set1_epi8(1)), _mm256_set1_epi16(1));
+}
+
+// Scores 8 positions per iteration, and returns the number scored. Each bitboard is split into
+// its low and high halves, so that the 8 positions' halves fill the 32-bit lanes.
+__attribute__((target("avx2")))
+size_t EvaluateAvx2(const PositionBatch& batch, int* scores, const RankTables& tables) {
+    const __m256i split_halves = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256i max_phase_lanes = _mm256_set1_epi32(max_phase);
+    const __m256 max_phase_floats = _mm256_set1_ps(max_phase);
+
+    size_t i = 0;
+    for (; i + 8 <= batch.Size(); i += 8) {
+        __m256i packed = _mm256_setzero_si256();
+        __m256i phase = _mm256_setzero_si256();
+
+        for (Color color : { Color::Black, Color::White }) {
+            for (int type = 0; type < 6; type++) {
+                const uint64_t* pieces = batch.Pieces(color, static_cast<PieceType>(type)) + i;
+                __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pieces));
+                __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pieces + 4));
+                if (_mm256_testz_si256(_mm256_or_si256(first, second), _mm256_set1_epi32(-1)))
+                    continue;
+
+                first = _mm256_permutevar8x32_epi32(first, split_halves);
+                second = _mm256_permutevar8x32_epi32(second, split_halves);
+                __m256i low = _mm256_permute2x128_si256(first, second, 0x20);
+                __m256i high = _mm256_permute2x128_si256(first, second, 0x31);
+
+                const int32_t* ranks = &tables.scores[static_cast<int>(color)][type][0][0];
+                packed = _mm256_add_epi32(packed, GatherRankScores(low, ranks));
+                packed = _mm256_add_epi32(packed, GatherRankScores(high, ranks + 4 * 256));
+
+                int weight = PhaseWeight(static_cast<PieceType>(type));
+                if (weight) {
+                    __m256i count = _mm256_add_epi32(Popcount32(low), Popcount32(high));
+                    phase = _mm256_add_epi32(phase, _mm256_mullo_epi32(count, _mm256_set1_epi32(weight)));
+                }
+            }
+        }
+
+        // Taper, as Evaluation::Taper does. The weighted sum is small enough to be exact as a
+        // float, so the truncated float quotient is the same as the integer one.
+        __m256i mg = _mm256_srai_epi32(_mm256_add_epi32(packed, _mm256_set1_epi32(0x8000)), 16);
+        __m256i eg = _mm256_srai_epi32(_mm256_slli_epi32(packed, 16), 16);
+        phase = _mm256_min_epi32(phase, max_phase_lanes);
+        __m256i sum = _mm256_add_epi32(_mm256_mullo_epi32(mg, phase),
+            _mm256_mullo_epi32(eg, _mm256_sub_epi32(max_phase_lanes, phase)));
+        __m256i score = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(sum), max_phase_floats));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(scores + i), score);
+    }
+    return i;
+}
+#endif
+
+} // namespace
+
+
+void PositionBatch::Clear() {
+    for (auto& color_pieces : pieces_) {
+        for (std::vector<uint64_t>& pieces : color_pieces)
+            pieces.clear();
+    }
+}
+
+void PositionBatch::Reserve(size_t count) {
+    for (auto& color_pieces : pieces_) {
+        for (std::vector<uint64_t>& pieces : color_pieces)
+            pieces.reserve(count);
+    }
+}
+
+void PositionBatch::Add(const BoardState& bs) {
+    static constexpr Bitboard PlayerBitboards::* members[6] = { &PlayerBitboards::pawns,
+        &PlayerBitboards::knights, &PlayerBitboards::bishops, &PlayerBitboards::rooks,
+        &PlayerBitboards::queens, &PlayerBitboards::king };
+
+    for (Color color : { Color::Black, Color::White }) {
+        const PlayerBitboards& player = bs.GetBitboards(color);
+        for (int type = 0; type < 6; type++)
+            pieces_[static_cast<int>(color)][type].push_back((player.*members[type]).GetBits());
+    }
+}
+
+bool Avx2Supported() {
+#if defined(BATCH_EVALUATION_AVX2)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+BatchBackend DefaultBatchBackend() {
+    return Avx2Supported() ? BatchBackend::Avx2 : BatchBackend::Scalar;
+}
+
+const char* BatchBackendName(BatchBackend backend) {
+    return (backend == BatchBackend::Avx2) ? "avx2" : "scalar";
+}
+
+bool EvaluateBatch(const PositionBatch& batch, int* scores, BatchBackend backend) {
+    if (backend == BatchBackend::Avx2 && !Avx2Supported())
+        return false;
+
+    const RankTables& tables = GetRankTables();
+    size_t done = 0;
+#if defined(BATCH_EVALUATION_AVX2)
+    if (backend == BatchBackend::Avx2)
+        done = EvaluateAvx2(batch, scores, tables);
+#endif
+
+    // The scalar version finishes off what doesn't fill a whole vector
+    EvaluateScalar(batch, scores, done, tables);
+    return true;
+}
+
+void EvaluateBatch(const PositionBatch& batch, int* scores) {
+    EvaluateBatch(batch, scores, DefaultBatchBackend());
+}
+
+} // namespace Evaluation
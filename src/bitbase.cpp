@@ -0,0 +1,329 @@
+#include "bitbase.h"
+#include "attacks.h"
+#include "board_state.h"
+#include "mapped_file.h"
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+namespace Bitbase {
+
+namespace {
+
+// Classification of a position during generation
+enum State : uint8_t { Unknown, Draw, Win, Illegal };
+
+struct Position {
+    unsigned strong_king;
+    unsigned weak_king;
+    unsigned piece;
+    bool strong_to_move;
+};
+
+Position Decode(uint32_t index) {
+    return { (index >> 13) & 63, (index >> 7) & 63, (index >> 1) & 63, (index & 1) != 0 };
+}
+
+bool IsWin(const std::vector<uint8_t>& bits, uint32_t index) {
+    return (bits[index >> 3] >> (index & 7)) & 1;
+}
+
+// Tiles attacked by the strong side's piece
+Bitboard PieceAttacks(Endgame endgame, unsigned piece, Bitboard occupied) {
+    switch (endgame) {
+    case Endgame::Kpk:
+        return Attacks::Pawn(Color::White, piece);
+    case Endgame::Krk:
+        return Attacks::Rook(piece, occupied);
+    default:
+        return Attacks::Queen(piece, occupied);
+    }
+}
+
+class Generator {
+public:
+    Generator(Endgame endgame, const std::vector<uint8_t>* kqk, const std::vector<uint8_t>* krk)
+        : endgame_(endgame), kqk_(kqk), krk_(krk), states_(num_positions), next_(num_positions) {}
+
+    std::vector<uint8_t> Run(unsigned threads);
+
+private:
+    State Classify(uint32_t index) const;
+    State Iterate(uint32_t index) const;
+
+    // Runs f(begin, end) on the index range, split between the threads, and returns the sum
+    // of what they return
+    template <typename F>
+    uint32_t Parallel(unsigned threads, F f);
+
+    Endgame endgame_;
+    const std::vector<uint8_t>* kqk_;
+    const std::vector<uint8_t>* krk_;
+    std::vector<uint8_t> states_;   // The last pass's results
+    std::vector<uint8_t> next_;     // This pass's results
+};
+
+template <typename F>
+uint32_t Generator::Parallel(unsigned threads, F f) {
+    std::vector<std::thread> workers;
+    std::vector<uint32_t> results(threads);
+    uint32_t chunk = (num_positions + threads - 1) / threads;
+
+    for (unsigned t = 0; t < threads; t++) {
+        uint32_t begin = t * chunk;
+        uint32_t end = (begin + chunk < num_positions) ? begin + chunk : num_positions;
+        workers.emplace_back([&f, &results, t, begin, end]() { results[t] = f(begin, end); });
+    }
+
+    uint32_t sum = 0;
+    for (unsigned t = 0; t < threads; t++) {
+        workers[t].join();
+        sum += results[t];
+    }
+    return sum;
+}
+
+// Classifies the positions that don't depend on any others
+State Generator::Classify(uint32_t index) const {
+    Position p = Decode(index);
+    Bitboard strong_king(1ULL << p.strong_king), weak_king(1ULL << p.weak_king), piece(1ULL << p.piece);
+
+    if (p.strong_king == p.weak_king || p.strong_king == p.piece || p.weak_king == p.piece)
+        return Illegal;
+    if ((Attacks::King(p.strong_king) & weak_king).GetBits())
+        return Illegal;
+    if (endgame_ == Endgame::Kpk && (p.piece < 8 || p.piece >= 56))
+        return Illegal;
+
+    Bitboard occupied = strong_king | weak_king | piece;
+    bool weak_in_check = (PieceAttacks(endgame_, p.piece, occupied) & weak_king).GetBits() != 0;
+
+    if (p.strong_to_move) {
+        // The weak side can't have been left in check
+        if (weak_in_check)
+            return Illegal;
+
+        // Promoting wins if the position with a new queen or rook (weak side to move) does
+        unsigned promotion = p.piece + 8;
+        if (endgame_ == Endgame::Kpk && p.piece >= 48 && promotion != p.strong_king && promotion != p.weak_king) {
+            uint32_t promoted = Index(p.strong_king, p.weak_king, promotion, false);
+            if (IsWin(*kqk_, promoted) || IsWin(*krk_, promoted))
+                return Win;
+        }
+        return Unknown;
+    }
+
+    // The weak king can go anywhere the strong side doesn't attack: including onto the piece,
+    // if the strong king doesn't defend it, which draws. A slider's attacks are through the
+    // weak king, so that it can't step back along the line it's attacked on.
+    Bitboard moves = Attacks::King(p.weak_king) & ~Attacks::King(p.strong_king)
+        & ~PieceAttacks(endgame_, p.piece, occupied & ~weak_king);
+    if ((moves & piece).GetBits())
+        return Draw;
+    if (!moves.GetBits())
+        return weak_in_check ? Win : Draw;
+    return Unknown;
+}
+
+// Classifies a position from the last pass's results for the positions it moves to
+State Generator::Iterate(uint32_t index) const {
+    Position p = Decode(index);
+    Bitboard strong_king(1ULL << p.strong_king), weak_king(1ULL << p.weak_king), piece(1ULL << p.piece);
+    Bitboard occupied = strong_king | weak_king | piece;
+
+    if (p.strong_to_move) {
+        // Any move to a win wins
+        Bitboard king_moves = Attacks::King(p.strong_king) & ~Attacks::King(p.weak_king) & ~piece;
+        while (king_moves.GetBits()) {
+            unsigned to = king_moves.BitscanForward();
+            king_moves.BitClear(to);
+            if (states_[Index(to, p.weak_king, p.piece, false)] == Win)
+                return Win;
+        }
+
+        Bitboard piece_moves;
+        if (endgame_ == Endgame::Kpk) {
+            // Promotions were classified up front
+            unsigned push = p.piece + 8;
+            if (push < 56 && !occupied.BitTest(push)) {
+                piece_moves.BitSet(push);
+                if (p.piece < 16 && !occupied.BitTest(push + 8))
+                    piece_moves.BitSet(push + 8);
+            }
+        } else {
+            piece_moves = PieceAttacks(endgame_, p.piece, occupied) & ~occupied;
+        }
+        while (piece_moves.GetBits()) {
+            unsigned to = piece_moves.BitscanForward();
+            piece_moves.BitClear(to);
+            if (states_[Index(p.strong_king, p.weak_king, to, false)] == Win)
+                return Win;
+        }
+        return Unknown;
+    }
+
+    // Every move must lose. Captures of the piece were classified as draws up front.
+    Bitboard moves = Attacks::King(p.weak_king) & ~Attacks::King(p.strong_king)
+        & ~PieceAttacks(endgame_, p.piece, occupied & ~weak_king);
+    while (moves.GetBits()) {
+        unsigned to = moves.BitscanForward();
+        moves.BitClear(to);
+        if (states_[Index(p.strong_king, to, p.piece, true)] != Win)
+            return Unknown;
+    }
+    return Win;
+}
+
+std::vector<uint8_t> Generator::Run(unsigned threads) {
+    Parallel(threads, [this](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+            states_[i] = Classify(i);
+        return 0u;
+    });
+
+    uint32_t changed;
+    do {
+        changed = Parallel(threads, [this](uint32_t begin, uint32_t end) {
+            uint32_t count = 0;
+            for (uint32_t i = begin; i < end; i++) {
+                next_[i] = (states_[i] == Unknown) ? static_cast<uint8_t>(Iterate(i)) : states_[i];
+                count += (next_[i] != states_[i]);
+            }
+            return count;
+        });
+        states_.swap(next_);
+    } while (changed);
+
+    std::vector<uint8_t> bits(file_size);
+    for (uint32_t i = 0; i < num_positions; i++) {
+        if (states_[i] == Win)
+            bits[i >> 3] |= 1 << (i & 7);
+    }
+    return bits;
+}
+
+
+const char* const file_names[num_endgames] = { "kpk.bin", "krk.bin", "kqk.bin" };
+
+// Mapped files, indexed by Endgame. Not owned by anything else, and only changed by Load and
+// Unload, so they must not be called during a search.
+const uint8_t* mapped[num_endgames];
+
+// Null unless the file is a bitbase's size
+const uint8_t* MapBitbase(const std::string& path) {
+    size_t size;
+    const uint8_t* data = MapFile(path.c_str(), size);
+    if (data && size != file_size) {
+        UnmapFile(data, size);
+        data = nullptr;
+    }
+    return data;
+}
+
+} // namespace
+
+
+const char* FileName(Endgame endgame) {
+    return file_names[static_cast<int>(endgame)];
+}
+
+uint32_t Index(unsigned strong_king, unsigned weak_king, unsigned piece, bool strong_to_move) {
+    return (strong_king << 13) | (weak_king << 7) | (piece << 1) | (strong_to_move ? 1 : 0);
+}
+
+std::vector<uint8_t> Generate(Endgame endgame, unsigned threads,
+        const std::vector<uint8_t>* kqk, const std::vector<uint8_t>* krk) {
+    Attacks::Init();
+    if (threads == 0)
+        threads = 1;
+
+    std::vector<uint8_t> generated_kqk, generated_krk;
+    if (endgame == Endgame::Kpk && !kqk) {
+        generated_kqk = Generate(Endgame::Kqk, threads);
+        kqk = &generated_kqk;
+    }
+    if (endgame == Endgame::Kpk && !krk) {
+        generated_krk = Generate(Endgame::Krk, threads);
+        krk = &generated_krk;
+    }
+    return Generator(endgame, kqk, krk).Run(threads);
+}
+
+bool Save(const std::vector<uint8_t>& bits, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+    bool ok = fwrite(bits.data(), 1, bits.size(), file) == bits.size();
+    return (fclose(file) == 0) && ok;
+}
+
+unsigned Load(const char* directory) {
+    Unload();
+    unsigned count = 0;
+    for (unsigned i = 0; i < num_endgames; i++) {
+        mapped[i] = MapBitbase(std::string(directory) + "/" + file_names[i]);
+        count += (mapped[i] != nullptr);
+    }
+    return count;
+}
+
+void Unload() {
+    for (const uint8_t*& data : mapped) {
+        UnmapFile(data, file_size);
+        data = nullptr;
+    }
+}
+
+bool IsLoaded(Endgame endgame) {
+    return mapped[static_cast<int>(endgame)] != nullptr;
+}
+
+bool AnyLoaded() {
+    return mapped[0] || mapped[1] || mapped[2];
+}
+
+Result Probe(const BoardState& bs) {
+    const PlayerBitboards& white = bs.GetBitboards(Color::White);
+    const PlayerBitboards& black = bs.GetBitboards(Color::Black);
+    if (__builtin_popcountll((white.GetBitboardsUnion() | black.GetBitboardsUnion()).GetBits()) != 3)
+        return Result::Unknown;
+
+    // The strong side has the extra piece
+    Color strong = (__builtin_popcountll(white.GetBitboardsUnion().GetBits()) == 2) ? Color::White : Color::Black;
+    const PlayerBitboards& strong_pieces = (strong == Color::White) ? white : black;
+    const PlayerBitboards& weak_pieces = (strong == Color::White) ? black : white;
+
+    Endgame endgame;
+    Bitboard piece;
+    if (strong_pieces.pawns.GetBits()) {
+        endgame = Endgame::Kpk;
+        piece = strong_pieces.pawns;
+    } else if (strong_pieces.rooks.GetBits()) {
+        endgame = Endgame::Krk;
+        piece = strong_pieces.rooks;
+    } else if (strong_pieces.queens.GetBits()) {
+        endgame = Endgame::Kqk;
+        piece = strong_pieces.queens;
+    } else {
+        return Result::Unknown;
+    }
+
+    // Castling isn't in the index
+    const uint8_t* data = mapped[static_cast<int>(endgame)];
+    CastlingRights rights = bs.GetCastlingRights(strong);
+    if (!data || (!rights.king_has_moved && !(rights.rook_a_has_moved && rights.rook_h_has_moved)))
+        return Result::Unknown;
+
+    // Mirrored, if the strong side is black
+    unsigned flip = (strong == Color::White) ? 0 : 56;
+    bool strong_to_move = bs.GetPlayerToMove() == strong;
+    uint32_t index = Index(strong_pieces.king.BitscanForward() ^ flip, weak_pieces.king.BitscanForward() ^ flip,
+        piece.BitscanForward() ^ flip, strong_to_move);
+
+    if (!((data[index >> 3] >> (index & 7)) & 1))
+        return Result::Draw;
+    return strong_to_move ? Result::Win : Result::Loss;
+}
+
+} // namespace Bitbase
@@ -61,10 +61,10 @@ Bitboard& PlayerBitboards::GetBitboardByType(enum PieceType type) {
     return pawns;
 }
 
-void PlayerBitboards::MovePiece(Move mv) {
-    Bitboard& bb = GetBitboardByType(mv.piece_type);
-    bb.BitClear(mv.src_tile_index);
-    bb.BitSet(mv.dest_tile_index);
+void PlayerBitboards::MovePiece(PieceType type, TileIndex src, TileIndex dest) {
+    Bitboard& bb = GetBitboardByType(type);
+    bb.BitClear(src);
+    bb.BitSet(dest);
 }
 
 void PlayerBitboards::DeletePiece(TileIndex index) {
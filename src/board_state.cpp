@@ -1,7 +1,15 @@
 #include "board_state.h"
+#include "attacks.h"
+#include "evaluation.h"
+#include "nnue.h"
+#include "pawn_structure.h"
+#include "zobrist.h"
+#include <cassert>
+#include <charconv>
 #include <cstring>
+#include <stdexcept>
 
-BoardState::BoardState() {
+BoardState::BoardState() : ply_counter(0), half_move_counter(0), accumulators(nullptr) {
     // Initialize pawns
     bitboards[static_cast<int>(Color::White)].pawns = Bitboard::initial_white_pawn_bits;
     bitboards[static_cast<int>(Color::Black)].pawns = Bitboard::initial_white_pawn_bits << (8 * 5);
@@ -15,92 +23,577 @@ BoardState::BoardState() {
         bitboards[i].queens = Bitboard::initial_white_queen_bits << shift_amount;
         bitboards[i].king = Bitboard::initial_white_king_bits << shift_amount;
     }
+
+    FillMailbox();
+    hash_key = ComputeHashKey();
+    pawn_hash_key = ComputePawnHashKey();
+    ComputeScore(psqt_score, game_phase);
+}
+
+namespace {
+
+[[noreturn]] void ThrowInvalidFen(std::string_view fen) {
+    throw std::invalid_argument("Invalid FEN: " + std::string(fen));
 }
 
-BoardState::BoardState(std::string init_state_fen) {
-    // Not implemented yet
-    assert(init_state_fen == "");
+// Removes the next whitespace separated field from the front of fen, and returns it (empty if
+// there are no more fields). The field is a view into fen, so nothing is copied.
+std::string_view NextFenField(std::string_view& fen) {
+    constexpr std::string_view whitespace = " \t\r\n";
+    size_t start = fen.find_first_not_of(whitespace);
+    if (start == std::string_view::npos) {
+        fen = std::string_view();
+        return fen;
+    }
 
-    memset(this, 0, sizeof(BoardState));
+    fen.remove_prefix(start);
+    std::string_view field = fen.substr(0, fen.find_first_of(whitespace));
+    fen.remove_prefix(field.size());
+    return field;
 }
 
-Color BoardState::GetPlayerToMove() const {
-    // Black moves on odd plies, since the ply count starts at 0.
-    return (ply_counter & 1) ? Color::Black : Color::White;    
+// Returns false unless the whole field is a decimal number
+bool ParseFenCounter(std::string_view field, unsigned& value) {
+    const char* end = field.data() + field.size();
+    std::from_chars_result result = std::from_chars(field.data(), end, value);
+    return !field.empty() && result.ec == std::errc() && result.ptr == end;
 }
 
-PlayerBitboards& BoardState::GetSelfBitboards() {
-    return bitboards[static_cast<int>(GetPlayerToMove())];
+// Writes value in decimal, and returns the position after it
+char* WriteFenCounter(char* out, unsigned value) {
+    return std::to_chars(out, out + 10, value).ptr;
 }
 
-PlayerBitboards& BoardState::GetOpponentBitboards() {
-    return bitboards[static_cast<int>(GetPlayerToMove()) ^ 1];
+} // namespace
+
+BoardState::BoardState(std::string_view init_state_fen)
+    : ply_counter(0), half_move_counter(0), hash_key(0), pawn_hash_key(0), psqt_score(),
+      game_phase(0), accumulators(nullptr) {
+    memset(piece_on, mailbox_empty, sizeof(piece_on));
+
+    // The empty string gives an empty board
+    if (init_state_fen.empty()) {
+        hash_key = Zobrist::Castling(GetCastlingIndex());
+        return;
+    }
+
+    std::string_view fields = init_state_fen;
+    std::string_view placement = NextFenField(fields);
+    std::string_view to_move = NextFenField(fields);
+    std::string_view castling_rights = NextFenField(fields);
+    std::string_view en_passant = NextFenField(fields);
+
+    // The move counters are commonly left off (e.g. in EPD files, which have operations here)
+    unsigned full_move_counter = 1;
+    if (!ParseFenCounter(NextFenField(fields), half_move_counter)
+            || !ParseFenCounter(NextFenField(fields), full_move_counter)) {
+        half_move_counter = 0;
+        full_move_counter = 1;
+    }
+
+    if (placement.empty() || (to_move != "w" && to_move != "b") || castling_rights.empty()
+            || en_passant.empty() || full_move_counter == 0)
+        ThrowInvalidFen(init_state_fen);
+
+    // Piece placement starts at A8, and runs rank by rank down to H1
+    int rank = 7;
+    int file = 0;
+    for (char c : placement) {
+        if (c == '/') {
+            if (file != 8 || rank == 0)
+                ThrowInvalidFen(init_state_fen);
+            rank--;
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+        } else {
+            TileContents tc = TileContentsFromFenChar(c);
+            if (tc.piece_type == PieceType::None || file > 7)
+                ThrowInvalidFen(init_state_fen);
+            SetTile(TileIndex(rank, file), tc);
+            file++;
+        }
+
+        if (file > 8)
+            ThrowInvalidFen(init_state_fen);
+    }
+    if (rank != 0 || file != 8)
+        ThrowInvalidFen(init_state_fen);
+
+    // Castling rights that are not listed are treated as if the rook had moved
+    for (int i = 0; i < 2; i++) {
+        castling[i].rook_a_has_moved = 1;
+        castling[i].rook_h_has_moved = 1;
+    }
+    if (castling_rights != "-") {
+        for (char c : castling_rights) {
+            switch (c) {
+                case 'K':   castling[static_cast<int>(Color::White)].rook_h_has_moved = 0;    break;
+                case 'Q':   castling[static_cast<int>(Color::White)].rook_a_has_moved = 0;    break;
+                case 'k':   castling[static_cast<int>(Color::Black)].rook_h_has_moved = 0;    break;
+                case 'q':   castling[static_cast<int>(Color::Black)].rook_a_has_moved = 0;    break;
+                default:    ThrowInvalidFen(init_state_fen);
+            }
+        }
+    }
+
+    // A castling right needs the king on its home tile, and the rook in its corner
+    for (int i = 0; i < 2; i++) {
+        unsigned back_rank = (i == static_cast<int>(Color::White)) ? 0 : 56;
+        bool king_home = bitboards[i].king.GetBits() & (1ULL << (back_rank + 4));
+        bool rook_a_home = bitboards[i].rooks.GetBits() & (1ULL << back_rank);
+        bool rook_h_home = bitboards[i].rooks.GetBits() & (1ULL << (back_rank + 7));
+        if ((!castling[i].rook_a_has_moved && !(king_home && rook_a_home))
+                || (!castling[i].rook_h_has_moved && !(king_home && rook_h_home)))
+            ThrowInvalidFen(init_state_fen);
+    }
+
+    // The target is behind a pawn of the player not to move, which has just double pushed
+    if (en_passant != "-") {
+        char target_rank = (to_move == "w") ? '6' : '3';
+        if (en_passant.size() != 2 || en_passant[0] < 'a' || en_passant[0] > 'h' || en_passant[1] != target_rank)
+            ThrowInvalidFen(init_state_fen);
+
+        TileIndex target(en_passant[1] - '1', en_passant[0] - 'a');
+        unsigned pawn_index = (to_move == "w") ? target - 8 : target + 8;
+        Color them = (to_move == "w") ? Color::Black : Color::White;
+        if (GetPieceType(target) != PieceType::None
+                || !(bitboards[static_cast<int>(them)].pawns.GetBits() & (1ULL << pawn_index)))
+            ThrowInvalidFen(init_state_fen);
+        en_passant_target_bitboard = Bitboard(target);
+    }
+
+    ply_counter = (full_move_counter - 1) * 2 + (to_move == "b" ? 1 : 0);
+
+    // SetTile has already hashed the pieces
+    hash_key ^= Zobrist::Castling(GetCastlingIndex()) ^ EnPassantHashKey();
+    if (GetPlayerToMove() == Color::Black)
+        hash_key ^= Zobrist::BlackToMove();
 }
 
-TileContents BoardState::GetTile(TileIndex index) const {
-    TileContents tc;
+size_t BoardState::WriteFen(char* buffer) const {
+    // Indexed by the mailbox color bit (Color::Black is 0), then by PieceType
+    static constexpr char piece_chars[2][6] = {
+        { 'p', 'n', 'b', 'r', 'q', 'k' },
+        { 'P', 'N', 'B', 'R', 'Q', 'K' },
+    };
+    char* out = buffer;
+
+    for (int rank = 7; rank >= 0; rank--) {
+        int empty = 0;
+        for (int file = 0; file < 8; file++) {
+            uint8_t piece = piece_on[rank * 8 + file];
+            if ((piece & 7) == mailbox_empty) {
+                empty++;
+                continue;
+            }
+            if (empty)
+                *out++ = '0' + empty;
+            empty = 0;
+            *out++ = piece_chars[piece >> 3][piece & 7];
+        }
+        if (empty)
+            *out++ = '0' + empty;
+        *out++ = (rank > 0) ? '/' : ' ';
+    }
+
+    *out++ = (GetPlayerToMove() == Color::White) ? 'w' : 'b';
+    *out++ = ' ';
 
-    tc.piece_type = bitboards[static_cast<int>(Color::Black)].GetTile(index);
-    if (tc.piece_type != PieceType::None) {
-        tc.color = Color::Black;
+    char* castling_start = out;
+    for (Color color : { Color::White, Color::Black }) {
+        CastlingRights rights = castling[static_cast<int>(color)];
+        char offset = (color == Color::White) ? 0 : 'a' - 'A';
+        if (!rights.king_has_moved && !rights.rook_h_has_moved)
+            *out++ = 'K' + offset;
+        if (!rights.king_has_moved && !rights.rook_a_has_moved)
+            *out++ = 'Q' + offset;
+    }
+    if (out == castling_start)
+        *out++ = '-';
+    *out++ = ' ';
+
+    if (en_passant_target_bitboard.GetBits()) {
+        unsigned index = en_passant_target_bitboard.BitscanForward();
+        *out++ = 'a' + (index & 7);
+        *out++ = '1' + (index >> 3);
     } else {
-        tc.piece_type = bitboards[static_cast<int>(Color::White)].GetTile(index);
-        tc.color = Color::White;
+        *out++ = '-';
     }
+    *out++ = ' ';
+
+    out = WriteFenCounter(out, half_move_counter);
+    *out++ = ' ';
+    out = WriteFenCounter(out, ply_counter / 2 + 1);
+    *out = '\0';
+    return out - buffer;
+}
 
-    return tc;
+std::string BoardState::GetFen() const {
+    char buffer[max_fen_length + 1];
+    return std::string(buffer, WriteFen(buffer));
+}
+
+// Returns TileContents with PieceType::None if c is not a FEN piece letter
+TileContents BoardState::TileContentsFromFenChar(char c) {
+    Color color = (c >= 'a' && c <= 'z') ? Color::Black : Color::White;
+
+    switch (c) {
+        case 'P': case 'p':     return TileContents(color, PieceType::Pawn);
+        case 'N': case 'n':     return TileContents(color, PieceType::Knight);
+        case 'B': case 'b':     return TileContents(color, PieceType::Bishop);
+        case 'R': case 'r':     return TileContents(color, PieceType::Rook);
+        case 'Q': case 'q':     return TileContents(color, PieceType::Queen);
+        case 'K': case 'k':     return TileContents(color, PieceType::King);
+    }
+    return TileContents();
 }
 
-bool BoardState::ApplyMove(Move move) {
-    if (move.captures) {
-        TileContents tc = GetTile(move.dest_tile_index);
-        move.captured_type = tc.piece_type;
-        GetOpponentBitboards().DeletePiece(move.dest_tile_index);
+void BoardState::SetAccumulators(Nnue::AccumulatorStack* new_accumulators) {
+    accumulators = new_accumulators;
+}
+
+CastlingRights BoardState::GetCastlingRights(Color color) const {
+    return castling[static_cast<int>(color)];
+}
+
+void BoardState::ApplyMove(Move move) {
+    UndoRecord undo;
+    ApplyMove(move, undo);
+}
+
+void BoardState::ApplyMove(Move move, UndoRecord& undo) {
+    if (accumulators)
+        accumulators->Push();
+
+    if (GetPlayerToMove() == Color::White)
+        ApplyMoveFor<Color::White>(move, undo);
+    else
+        ApplyMoveFor<Color::Black>(move, undo);
+
+#ifdef DEBUG_HASH_KEYS
+    assert(HashKeysAreConsistent());
+#endif
+#ifdef DEBUG_EVALUATION
+    assert(EvaluationIsConsistent());
+#endif
+}
+
+void BoardState::UndoMove(Move move, const UndoRecord& undo) {
+    // The player who made the move is the one not to move now
+    if (GetPlayerToMove() == Color::White)
+        UndoMoveFor<Color::Black>(move, undo);
+    else
+        UndoMoveFor<Color::White>(move, undo);
+
+    if (accumulators)
+        accumulators->Pop();
+
+#ifdef DEBUG_HASH_KEYS
+    assert(HashKeysAreConsistent());
+#endif
+#ifdef DEBUG_EVALUATION
+    assert(EvaluationIsConsistent());
+#endif
+}
+
+// Us is the player making the move, so the piece tables, pawn directions and back rank are
+// compile time constants
+template <Color Us>
+void BoardState::ApplyMoveFor(Move move, UndoRecord& undo) {
+    constexpr Color them = OtherColor(Us);
+    constexpr int up = TileIndexOffsetFromDirection((Us == Color::White) ? Direction::North : Direction::South);
+    constexpr unsigned back_rank_offset = (Us == Color::White) ? 0 : 56;
+
+    PlayerBitboards& self = bitboards[static_cast<int>(Us)];
+    PlayerBitboards& opponent = bitboards[static_cast<int>(them)];
+    TileIndex src = move.GetSrcTileIndex();
+    TileIndex dest = move.GetDestTileIndex();
+    PieceType type = GetPieceType(src);
+
+    undo.captured_type = PieceType::None;
+    undo.prev_castling_rights[0] = castling[0];
+    undo.prev_castling_rights[1] = castling[1];
+    undo.prev_en_passant_target = en_passant_target_bitboard;
+    undo.prev_half_move_counter = half_move_counter;
+    undo.prev_hash_key = hash_key;
+    undo.prev_pawn_hash_key = pawn_hash_key;
+    undo.prev_psqt_score = psqt_score;
+    undo.prev_game_phase = game_phase;
+
+    // Castling rights and en passant target are hashed out here, and back in once updated
+    hash_key ^= Zobrist::Castling(GetCastlingIndex()) ^ EnPassantHashKey<Us>();
+
+    if (move.IsEnPassant()) {
+        // The captured pawn is behind the destination tile
+        TileIndex captured_index = static_cast<unsigned>(dest) - up;
+        opponent.pawns.BitClear(captured_index);
+        PieceRemoved(them, PieceType::Pawn, captured_index);
+        undo.captured_type = PieceType::Pawn;
+    } else if (move.IsCapture()) {
+        undo.captured_type = GetPieceType(dest);
+        opponent.GetBitboardByType(undo.captured_type).BitClear(dest);
+        PieceRemoved(them, undo.captured_type, dest);
+    }
+
+    self.MovePiece(type, src, dest);
+    PieceRemoved(Us, type, src);
+    PieceAdded(Us, type, dest);
+
+    if (move.IsPromotion()) {
+        self.pawns.BitClear(dest);
+        self.GetBitboardByType(move.GetPromotionType()).BitSet(dest);
+        PieceRemoved(Us, PieceType::Pawn, dest);
+        PieceAdded(Us, move.GetPromotionType(), dest);
+    } else if (move.IsCastle()) {
+        // The rook moves to the other side of the king
+        TileIndex rook_src = back_rank_offset + ((move.GetFlags() == Move::KingCastle) ? 7 : 0);
+        TileIndex rook_dest = back_rank_offset + ((move.GetFlags() == Move::KingCastle) ? 5 : 3);
+        self.MovePiece(PieceType::Rook, rook_src, rook_dest);
+        PieceRemoved(Us, PieceType::Rook, rook_src);
+        PieceAdded(Us, PieceType::Rook, rook_dest);
     }
 
-    GetSelfBitboards().MovePiece(move);
+    // Moving a king or rook (or capturing a rook) loses the associated castling rights
+    UpdateCastlingRights(src);
+    UpdateCastlingRights(dest);
+
+    en_passant_target_bitboard = Bitboard(0);
+    if (move.GetFlags() == Move::DoublePawnPush)
+        en_passant_target_bitboard = Bitboard(TileIndex(static_cast<unsigned>(src) + up));
+
+    hash_key ^= Zobrist::Castling(GetCastlingIndex()) ^ EnPassantHashKey<them>();
+    hash_key ^= Zobrist::BlackToMove();
+
+    if (type == PieceType::Pawn || undo.captured_type != PieceType::None)
+        half_move_counter = 0;
+    else
+        half_move_counter++;
 
     ply_counter++;
+}
 
-    // TODO: update castling rights, move counters, en passant info...
+// Us is the player who made the move
+template <Color Us>
+void BoardState::UndoMoveFor(Move move, const UndoRecord& undo) {
+    constexpr Color them = OtherColor(Us);
+    constexpr int up = TileIndexOffsetFromDirection((Us == Color::White) ? Direction::North : Direction::South);
+    constexpr unsigned back_rank_offset = (Us == Color::White) ? 0 : 56;
+
+    ply_counter--;
+
+    PlayerBitboards& self = bitboards[static_cast<int>(Us)];
+    PlayerBitboards& opponent = bitboards[static_cast<int>(them)];
+    TileIndex src = move.GetSrcTileIndex();
+    TileIndex dest = move.GetDestTileIndex();
+
+    if (move.IsPromotion()) {
+        self.GetBitboardByType(move.GetPromotionType()).BitClear(dest);
+        self.pawns.BitSet(dest);
+        piece_on[dest] = MailboxPiece(Us, PieceType::Pawn);
+    } else if (move.IsCastle()) {
+        unsigned rook_src = back_rank_offset + ((move.GetFlags() == Move::KingCastle) ? 7 : 0);
+        unsigned rook_dest = back_rank_offset + ((move.GetFlags() == Move::KingCastle) ? 5 : 3);
+        self.MovePiece(PieceType::Rook, rook_dest, rook_src);
+        piece_on[rook_src] = piece_on[rook_dest];
+        piece_on[rook_dest] = mailbox_empty;
+    }
 
-    return true;
+    self.MovePiece(GetPieceType(dest), dest, src);
+    piece_on[src] = piece_on[dest];
+    piece_on[dest] = mailbox_empty;
+
+    if (move.IsEnPassant()) {
+        TileIndex captured_index = static_cast<unsigned>(dest) - up;
+        opponent.pawns.BitSet(captured_index);
+        piece_on[captured_index] = MailboxPiece(them, PieceType::Pawn);
+    } else if (undo.captured_type != PieceType::None) {
+        opponent.GetBitboardByType(undo.captured_type).BitSet(dest);
+        piece_on[dest] = MailboxPiece(them, undo.captured_type);
+    }
+
+    castling[0] = undo.prev_castling_rights[0];
+    castling[1] = undo.prev_castling_rights[1];
+    en_passant_target_bitboard = undo.prev_en_passant_target;
+    half_move_counter = undo.prev_half_move_counter;
+    hash_key = undo.prev_hash_key;
+    pawn_hash_key = undo.prev_pawn_hash_key;
+    psqt_score = undo.prev_psqt_score;
+    game_phase = undo.prev_game_phase;
 }
 
-void BoardState::SetTile(TileIndex index, TileContents tc) {
-    Bitboard bb;
-    if (tc.color == Color::White) {
-        bb = bitboards[static_cast<int>(Color::White)].GetBitboardByType(tc.piece_type);
-    } else {
-        bb = bitboards[static_cast<int>(Color::Black)].GetBitboardByType(tc.piece_type);
+void BoardState::UpdateCastlingRights(TileIndex index) {
+    CastlingRights& white = castling[static_cast<int>(Color::White)];
+    CastlingRights& black = castling[static_cast<int>(Color::Black)];
+
+    switch (index.value_) {
+        case TileName::A1:  white.rook_a_has_moved = 1;     break;
+        case TileName::H1:  white.rook_h_has_moved = 1;     break;
+        case TileName::E1:  white.king_has_moved = 1;       break;
+        case TileName::A8:  black.rook_a_has_moved = 1;     break;
+        case TileName::H8:  black.rook_h_has_moved = 1;     break;
+        case TileName::E8:  black.king_has_moved = 1;       break;
+        default:                                            break;
+    }
+}
+
+// Index of the castling rights that are still available, for Zobrist::Castling
+unsigned BoardState::GetCastlingIndex() const {
+    const CastlingRights& white = castling[static_cast<int>(Color::White)];
+    const CastlingRights& black = castling[static_cast<int>(Color::Black)];
+    unsigned index = 0;
+
+    if (!white.king_has_moved) {
+        index |= white.rook_h_has_moved ? 0 : Zobrist::white_king_side;
+        index |= white.rook_a_has_moved ? 0 : Zobrist::white_queen_side;
+    }
+    if (!black.king_has_moved) {
+        index |= black.rook_h_has_moved ? 0 : Zobrist::black_king_side;
+        index |= black.rook_a_has_moved ? 0 : Zobrist::black_queen_side;
     }
+    return index;
+}
+
+// Toggles a piece in (or out of) the hash keys
+void BoardState::HashPiece(Color color, PieceType type, TileIndex index) {
+    uint64_t key = Zobrist::Piece(color, type, index);
+    hash_key ^= key;
+    if (type == PieceType::Pawn)
+        pawn_hash_key ^= key;
+}
 
+uint64_t BoardState::EnPassantHashKey() const {
+    return (GetPlayerToMove() == Color::White) ? EnPassantHashKey<Color::White>() : EnPassantHashKey<Color::Black>();
+}
+
+// The en passant file is only hashed if a pawn of Us (the player to move) could capture on the
+// target, whether or not the capture is legal, as in Polyglot keys. Otherwise every double push
+// would give a key that no transposition without it shares.
+template <Color Us>
+uint64_t BoardState::EnPassantHashKey() const {
+    uint64_t target = en_passant_target_bitboard.GetBits();
+    if (!target)
+        return 0;
+    Bitboard capturers = Attacks::Pawn(OtherColor(Us), __builtin_ctzll(target)) & bitboards[static_cast<int>(Us)].pawns;
+    return capturers.GetBits() ? Zobrist::EnPassant(en_passant_target_bitboard) : 0;
+}
+
+uint64_t BoardState::ComputeHashKey() const {
+    uint64_t key = ComputePawnHashKey();
+
+    for (int color = 0; color < 2; color++) {
+        PlayerBitboards pb = bitboards[color];
+        for (int type = static_cast<int>(PieceType::Knight); type <= static_cast<int>(PieceType::King); type++) {
+            uint64_t bits = pb.GetBitboardByType(static_cast<PieceType>(type)).GetBits();
+            for (; bits; bits &= bits - 1)
+                key ^= Zobrist::Piece(static_cast<Color>(color), static_cast<PieceType>(type), __builtin_ctzll(bits));
+        }
+    }
+
+    key ^= Zobrist::Castling(GetCastlingIndex()) ^ EnPassantHashKey();
+    if (GetPlayerToMove() == Color::Black)
+        key ^= Zobrist::BlackToMove();
+    return key;
+}
+
+uint64_t BoardState::ComputePawnHashKey() const {
+    uint64_t key = 0;
+    for (int color = 0; color < 2; color++) {
+        for (uint64_t bits = bitboards[color].pawns.GetBits(); bits; bits &= bits - 1)
+            key ^= Zobrist::Piece(static_cast<Color>(color), PieceType::Pawn, __builtin_ctzll(bits));
+    }
+    return key;
+}
+
+uint64_t BoardState::GetHashKey() const {
+    return hash_key;
+}
+
+uint64_t BoardState::GetPawnHashKey() const {
+    return pawn_hash_key;
+}
+
+bool BoardState::HashKeysAreConsistent() const {
+    return hash_key == ComputeHashKey() && pawn_hash_key == ComputePawnHashKey();
+}
+
+// The mailbox, hash keys and evaluation terms are updated together, for each piece which is
+// added to or removed from the bitboards
+void BoardState::PieceAdded(Color color, PieceType type, TileIndex index) {
+    piece_on[index] = MailboxPiece(color, type);
+    HashPiece(color, type, index);
+    psqt_score += Evaluation::PieceScore(color, type, index);
+    game_phase += Evaluation::PhaseWeight(type);
+    if (accumulators)
+        accumulators->PieceChanged(color, type, index, true);
+}
+
+void BoardState::PieceRemoved(Color color, PieceType type, TileIndex index) {
+    piece_on[index] = mailbox_empty;
+    HashPiece(color, type, index);
+    psqt_score -= Evaluation::PieceScore(color, type, index);
+    game_phase -= Evaluation::PhaseWeight(type);
+    if (accumulators)
+        accumulators->PieceChanged(color, type, index, false);
+}
+
+void BoardState::FillMailbox() {
+    for (unsigned i = 0; i < TileIndex::num_tiles; i++) {
+        piece_on[i] = mailbox_empty;
+        for (Color color : { Color::Black, Color::White }) {
+            PieceType type = bitboards[static_cast<int>(color)].GetTile(i);
+            if (type != PieceType::None)
+                piece_on[i] = MailboxPiece(color, type);
+        }
+    }
+}
+
+bool BoardState::MailboxIsConsistent() const {
+    BoardState copy = *this;
+    copy.FillMailbox();
+    return memcmp(piece_on, copy.piece_on, sizeof(piece_on)) == 0;
+}
+
+void BoardState::ComputeScore(Evaluation::Score& score, int& phase) const {
+    score = Evaluation::Score{ 0, 0 };
+    phase = 0;
+
+    for (int color = 0; color < 2; color++) {
+        PlayerBitboards pb = bitboards[color];
+        for (int type = static_cast<int>(PieceType::Pawn); type <= static_cast<int>(PieceType::King); type++) {
+            uint64_t bits = pb.GetBitboardByType(static_cast<PieceType>(type)).GetBits();
+            for (; bits; bits &= bits - 1) {
+                score += Evaluation::PieceScore(static_cast<Color>(color), static_cast<PieceType>(type), __builtin_ctzll(bits));
+                phase += Evaluation::PhaseWeight(static_cast<PieceType>(type));
+            }
+        }
+    }
+}
+
+bool BoardState::EvaluationIsConsistent() const {
+    Evaluation::Score score;
+    int phase;
+    ComputeScore(score, phase);
+    return score == psqt_score && phase == game_phase;
+}
+
+void BoardState::SetTile(TileIndex index, TileContents tc) {
+    assert(tc.color != Color::None);
+    Bitboard& bb = bitboards[static_cast<int>(tc.color)].GetBitboardByType(tc.piece_type);
     bb.BitSet(index);
+    PieceAdded(tc.color, tc.piece_type, index);
 }
 
+// Material and piece-square scores, tapered between the middlegame and endgame by the phase.
 // Possible enhancements to the evaluation:
-//  * Account for doubled, blocked, and isolated pawns
 //  * Account for mobility (total number of legal moves for the player)
-//  * Account for location (piece value squares)
-double BoardState::GetPlayerEvaluation(const PlayerBitboards& pb) const {
-    constexpr double kPieceWeightPawn = 1.0;
-    constexpr double kPieceWeightKnight = 3.0;
-    constexpr double kPieceWeightBishop = 3.1;
-    constexpr double kPieceWeightRook = 5.2;
-    constexpr double kPieceWeightQueen = 9.0;
-    constexpr double kPieceWeightKing = 20.0;
-
-    double score = 0;
-    score += __builtin_popcountll(pb.pawns.GetBits()) * kPieceWeightPawn;
-    score += __builtin_popcountll(pb.knights.GetBits()) * kPieceWeightKnight;
-    score += __builtin_popcountll(pb.bishops.GetBits()) * kPieceWeightBishop;
-    score += __builtin_popcountll(pb.rooks.GetBits()) * kPieceWeightRook;
-    score += __builtin_popcountll(pb.queens.GetBits()) * kPieceWeightQueen;
-    score += __builtin_popcountll(pb.king.GetBits()) * kPieceWeightKing;
-    return score;
-}
-
-double BoardState::GetEvaluation() const {
-    return GetPlayerEvaluation(bitboards[static_cast<int>(Color::White)])
-        - GetPlayerEvaluation(bitboards[static_cast<int>(Color::Black)]);
-}
\ No newline at end of file
+int BoardState::GetEvaluation() const {
+    return Evaluation::Taper(psqt_score, game_phase);
+}
+
+int BoardState::GetEvaluation(PawnHashTable& pawn_table) const {
+    Evaluation::Score pawn_score = pawn_table.Probe(pawn_hash_key,
+        bitboards[static_cast<int>(Color::White)].pawns.GetBits(),
+        bitboards[static_cast<int>(Color::Black)].pawns.GetBits());
+    return Evaluation::Taper(psqt_score + pawn_score, game_phase);
+}
@@ -1,65 +1,407 @@
 #include "chess_engine.h"
 #include "bitboard.h"
-#include <cstdlib>
+#include "attacks.h"
+#include "nnue.h"
+#include "random.h"
 
+#include <atomic>
 #include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
 
 
 
 
 Move ChessEngine::SelectMove(BoardState& bs) {
-    GenerateMoves(bs);
-    assert(move_list_.size() > 0);
+    Move move = GetBookMove(bs);
+    return move.IsNull() ? RunSearch(bs).best_move : move;
+}
+
+SearchResult ChessEngine::RunSearch(BoardState& bs) {
+    if (!tt_)
+        tt_.reset(new TranspositionTable(hash_size_mb_));
+    tt_->NewSearch();
+
+    // Each helper thread has its own engine (for its move generation state) and board, and
+    // searches without limits until the main search finishes. The boards are copied before
+    // any thread starts, since the main search modifies bs.
+    std::atomic<bool> stop(false);
+    std::vector<BoardState> helper_boards(threads_ - 1, bs);
+    std::vector<uint64_t> helper_nodes(threads_ - 1);
+    std::vector<std::thread> helpers;
+    for (unsigned i = 1; i < threads_; i++) {
+        helpers.emplace_back([this, &stop, &helper_boards, &helper_nodes, i]() {
+            ChessEngine engine;
+            engine.SetEvaluator(evaluator_);
+            BoardState& board = helper_boards[i - 1];
+            SearchLimits limits;
+            limits.depth = 0;
+            Search search(engine, *tt_, i, &stop);
+            helper_nodes[i - 1] = search.Run(board, limits).nodes;
+        });
+    }
 
-    // for (int i = 0; i < move_list_.size(); i++) {
-    //     move_list_[i].Print();
-    // }
+    Search search(*this, *tt_);
+    SearchResult result = search.Run(bs, search_limits_);
 
-    return move_list_[rand() % move_list_.size()];
+    stop = true;
+    for (unsigned i = 0; i < helpers.size(); i++) {
+        helpers[i].join();
+        result.nodes += helper_nodes[i];
+    }
+    return result;
 }
 
-// TODO: detect checks against our king
-bool ChessEngine::IsLegalMove(BoardState& bs, Move move) {
-    GenerateMoves(bs);
+void ChessEngine::SetSearchLimits(const SearchLimits& limits) {
+    search_limits_ = limits;
+}
+
+void ChessEngine::SetThreads(unsigned threads) {
+    threads_ = (threads > 0) ? threads : 1;
+}
 
-    std::vector<Move>::iterator it;
-    for (it = move_list_.begin(); it != move_list_.end(); it++) {
-        if (it->src_tile_index == move.src_tile_index &&
-            it->dest_tile_index == move.dest_tile_index) {
+void ChessEngine::SetHashSize(size_t size_mb) {
+    hash_size_mb_ = size_mb;
+    if (tt_)
+        tt_->Resize(size_mb);
+}
+
+bool ChessEngine::SetEvaluator(Evaluator evaluator) {
+    if (evaluator == Evaluator::Nnue && !Nnue::IsLoaded())
+        return false;
+    evaluator_ = evaluator;
+    return true;
+}
+
+bool ChessEngine::SetBook(const char* path) {
+    if (!book_)
+        book_.reset(new PolyglotBook);
+    if (!book_->Open(path))
+        return false;
+
+    // Seeded differently each time, so that games don't all follow the same line
+    book_random_state_ = (static_cast<uint64_t>(std::random_device()()) << 32) | std::random_device()() | 1;
+    return true;
+}
+
+Move ChessEngine::GetBookMove(BoardState& bs) {
+    if (!book_ || !book_->IsOpen())
+        return Move();
+
+    return book_->PickMove(*this, bs, XorShift64Star(book_random_state_));
+}
+
+PawnHashTable& ChessEngine::GetPawnHashTable() {
+    if (!pawn_table_)
+        pawn_table_.reset(new PawnHashTable);
+    return *pawn_table_;
+}
+
+bool ChessEngine::IsLegalMove(BoardState& bs, Move& move) {
+    MoveList moves;
+    GenerateMoves(bs, moves);
+
+    // Queen promotions are generated first, so they match if no promotion type was given
+    for (const Move& m : moves) {
+        if (m.GetSrcTileIndex() == move.GetSrcTileIndex() &&
+            m.GetDestTileIndex() == move.GetDestTileIndex() &&
+            (!move.IsPromotion() || (m.IsPromotion() && m.GetPromotionType() == move.GetPromotionType()))) {
+            move = m;
             return true;
         }
     }
     return false;
 }
 
-bool ChessEngine::IsOwnKingInCheck(BoardState& bs) {
-    unsigned king_index = bs.GetSelfBitboards().king.BitscanForward();
+// A piece attacks index exactly when the same kind of piece on index would attack it. Pawns
+// are the exception: they attack the tiles that a pawn of the other color would attack them from.
+Bitboard ChessEngine::AttackersTo(const BoardState& bs, TileIndex index, Bitboard occupied) const {
+    if (Attacks::GetBackend() == Attacks::Backend::Pext)
+        return AttackersTo<Attacks::Backend::Pext>(bs, index, occupied);
+    return AttackersTo<Attacks::Backend::Magic>(bs, index, occupied);
+}
 
-    Bitboard knight_attacks = GetKnightAttacks(king_index);
-    Bitboard bishop_attacks = GetBishopAttacks(king_index);
-    Bitboard rook_attacks = GetRookAttacks(king_index);
-    
-    // TODO: implement
-    return false;
+template <Attacks::Backend B>
+Bitboard ChessEngine::AttackersTo(const BoardState& bs, TileIndex index, Bitboard occupied) const {
+    const PlayerBitboards& white = bs.GetBitboards(Color::White);
+    const PlayerBitboards& black = bs.GetBitboards(Color::Black);
+
+    return (Attacks::Pawn(Color::Black, index) & white.pawns)
+        | (Attacks::Pawn(Color::White, index) & black.pawns)
+        | (Attacks::Knight(index) & (white.knights | black.knights))
+        | (Attacks::King(index) & (white.king | black.king))
+        | (Attacks::Bishop<B>(index, occupied) & (white.bishops | white.queens | black.bishops | black.queens))
+        | (Attacks::Rook<B>(index, occupied) & (white.rooks | white.queens | black.rooks | black.queens));
+}
+
+// The leaper tests are single table lookups, so they go first. Sliders are only looked up if
+// there are any which could attack.
+bool ChessEngine::IsSquareAttacked(const BoardState& bs, TileIndex index, Color by_color) const {
+    if (Attacks::GetBackend() == Attacks::Backend::Pext)
+        return IsSquareAttacked<Attacks::Backend::Pext>(bs, index, by_color);
+    return IsSquareAttacked<Attacks::Backend::Magic>(bs, index, by_color);
+}
+
+template <Attacks::Backend B>
+bool ChessEngine::IsSquareAttacked(const BoardState& bs, TileIndex index, Color by_color) const {
+    const PlayerBitboards& attacker = bs.GetBitboards(by_color);
+
+    if ((Attacks::Pawn(OtherColor(by_color), index) & attacker.pawns).GetBits()
+            || (Attacks::Knight(index) & attacker.knights).GetBits()
+            || (Attacks::King(index) & attacker.king).GetBits())
+        return true;
+
+    Bitboard occupied = bs.GetBitboards(Color::White).GetBitboardsUnion()
+        | bs.GetBitboards(Color::Black).GetBitboardsUnion();
+    Bitboard diagonal = attacker.bishops | attacker.queens;
+    if (diagonal.GetBits() && (Attacks::Bishop<B>(index, occupied) & diagonal).GetBits())
+        return true;
+
+    Bitboard orthogonal = attacker.rooks | attacker.queens;
+    return orthogonal.GetBits() && (Attacks::Rook<B>(index, occupied) & orthogonal).GetBits();
 }
 
-void ChessEngine::GenerateMoves(BoardState& bs) {
-    targets_ = bs.GetOpponentBitboards().GetBitboardsUnion();
-    friendlies_ = bs.GetSelfBitboards().GetBitboardsUnion();
+bool ChessEngine::IsOwnKingInCheck(const BoardState& bs) const {
+    Color color = bs.GetPlayerToMove();
+    Bitboard king = bs.GetBitboards(color).king;
+    return king.GetBits() && IsSquareAttacked(bs, king.BitscanForward(), OtherColor(color));
+}
+
+void ChessEngine::GenerateMoves(BoardState& bs, MoveList& moves, GenType type) {
+    legal_ = true;
+    gen_type_ = type;
+    GenerateAllMoves(bs, moves);
+}
+
+void ChessEngine::GeneratePseudoLegalMoves(BoardState& bs, MoveList& moves) {
+    legal_ = false;
+    gen_type_ = GenType::All;
+    GenerateAllMoves(bs, moves);
+}
+
+// Everything below depends on the player to move, so it is built once for each color, and
+// once for each attack backend
+void ChessEngine::GenerateAllMoves(BoardState& bs, MoveList& moves) {
+    using Attacks::Backend;
+    bool white = bs.GetPlayerToMove() == Color::White;
+    if (Attacks::GetBackend() == Backend::Pext) {
+        if (white)
+            GenerateAllMoves<Color::White, Backend::Pext>(bs, moves);
+        else
+            GenerateAllMoves<Color::Black, Backend::Pext>(bs, moves);
+    } else {
+        if (white)
+            GenerateAllMoves<Color::White, Backend::Magic>(bs, moves);
+        else
+            GenerateAllMoves<Color::Black, Backend::Magic>(bs, moves);
+    }
+}
+
+template <Color Us, Attacks::Backend B>
+void ChessEngine::GenerateAllMoves(BoardState& bs, MoveList& moves) {
+    targets_ = bs.GetBitboards(OtherColor(Us)).GetBitboardsUnion();
+    friendlies_ = bs.GetBitboards(Us).GetBitboardsUnion();
     occupied_tiles_ = targets_ | friendlies_;
     empty_tiles_ = ~occupied_tiles_;
+    capture_targets_ = (gen_type_ != GenType::Quiets) ? targets_ : Bitboard();
+    quiet_targets_ = (gen_type_ != GenType::Captures) ? empty_tiles_ : Bitboard();
+
+    moves.Clear();
+
+    if (legal_) {
+        FindCheckersAndPins<Us, B>(bs);
 
-    move_list_.clear();
+        // In double check, only the king can move
+        uint64_t checker_bits = checkers_.GetBits();
+        if (checker_bits & (checker_bits - 1)) {
+            GenerateKingMoves<Us, B>(bs, moves);
+            return;
+        }
+    } else {
+        checkers_ = Bitboard();
+        pinned_ = Bitboard();
+        check_mask_ = Bitboard(~0ULL);
+        king_danger_ = Bitboard();
+    }
 
-    GeneratePawnMoves(bs);
-    GenerateKnightMoves(bs);
-    GenerateBishopMoves(bs);
-    GenerateRookMoves(bs);
-    GenerateQueenMoves(bs);
-    GenerateKingMoves(bs);
+    GeneratePawnMoves<Us, B>(bs, moves);
+    GenerateKnightMoves<Us>(bs, moves);
+    GenerateBishopMoves<Us, B>(bs, moves);
+    GenerateRookMoves<Us, B>(bs, moves);
+    GenerateQueenMoves<Us, B>(bs, moves);
+    GenerateKingMoves<Us, B>(bs, moves);
 }
 
-// TODO: replace with table lookup. Can use this to generate the tables.
+template <Color Us, Attacks::Backend B>
+void ChessEngine::FindCheckersAndPins(BoardState& bs) {
+    const PlayerBitboards& self = bs.GetBitboards(Us);
+    const PlayerBitboards& opponent = bs.GetBitboards(OtherColor(Us));
+    assert(self.king.GetBits());
+
+    king_index_ = self.king.BitscanForward();
+    checkers_ = AttackersTo<B>(bs, king_index_, occupied_tiles_) & targets_;
+
+    // A slider pins a piece if that piece is all that stands between it and our king. Sliders
+    // which could pin are found by looking from the king through our own pieces.
+    Bitboard diagonal = opponent.bishops | opponent.queens;
+    Bitboard orthogonal = opponent.rooks | opponent.queens;
+    Bitboard pinners = (Attacks::Bishop<B>(king_index_, targets_) & diagonal)
+        | (Attacks::Rook<B>(king_index_, targets_) & orthogonal);
+
+    pinned_ = Bitboard();
+    while (pinners.GetBits()) {
+        unsigned pinner_index = pinners.BitscanForward();
+        pinners.BitClear(pinner_index);
+
+        Bitboard blockers = Attacks::Between(king_index_, pinner_index) & occupied_tiles_;
+        uint64_t blocker_bits = blockers.GetBits();
+        if (blocker_bits && !(blocker_bits & (blocker_bits - 1)) && (blockers & friendlies_).GetBits())
+            pinned_ |= blockers;
+    }
+
+    // A single check is evaded by capturing the checker or blocking between it and the king
+    if (checkers_.GetBits()) {
+        unsigned checker_index = checkers_.BitscanForward();
+        check_mask_ = Attacks::Between(king_index_, checker_index) | checkers_;
+    } else {
+        check_mask_ = Bitboard(~0ULL);
+    }
+
+    // Sliders see through the king, so that it can't step back along the ray it is checked on.
+    // Only king captures are generated in capture mode, and GenerateKingMoves tests those.
+    if (gen_type_ != GenType::Captures)
+        king_danger_ = GetAttackedTiles<OtherColor(Us), B>(bs, occupied_tiles_ ^ self.king);
+    else
+        king_danger_ = Bitboard();
+}
+
+template <Color Them, Attacks::Backend B>
+Bitboard ChessEngine::GetAttackedTiles(BoardState& bs, Bitboard occupied) const {
+    const PlayerBitboards& pieces = bs.GetBitboards(Them);
+
+    Bitboard attacked = (Them == Color::White)
+        ? pieces.pawns.StepNorthWest() | pieces.pawns.StepNorthEast()
+        : pieces.pawns.StepSouthWest() | pieces.pawns.StepSouthEast();
+
+    Bitboard knights = pieces.knights;
+    while (knights.GetBits()) {
+        unsigned index = knights.BitscanForward();
+        knights.BitClear(index);
+        attacked |= Attacks::Knight(index);
+    }
+
+    Bitboard diagonal = pieces.bishops | pieces.queens;
+    while (diagonal.GetBits()) {
+        unsigned index = diagonal.BitscanForward();
+        diagonal.BitClear(index);
+        attacked |= Attacks::Bishop<B>(index, occupied);
+    }
+
+    Bitboard orthogonal = pieces.rooks | pieces.queens;
+    while (orthogonal.GetBits()) {
+        unsigned index = orthogonal.BitscanForward();
+        orthogonal.BitClear(index);
+        attacked |= Attacks::Rook<B>(index, occupied);
+    }
+
+    if (pieces.king.GetBits())
+        attacked |= Attacks::King(pieces.king.BitscanForward());
+    return attacked;
+}
+
+template <Color Us, Attacks::Backend B>
+bool ChessEngine::EnPassantExposesKing(BoardState& bs, TileIndex src, TileIndex dest) const {
+    constexpr int up = TileIndexOffsetFromDirection((Us == Color::White) ? Direction::North : Direction::South);
+    const PlayerBitboards& opponent = bs.GetBitboards(OtherColor(Us));
+
+    // The captured pawn is behind the destination tile
+    TileIndex captured = static_cast<unsigned>(dest) - up;
+    Bitboard occupied = occupied_tiles_ ^ Bitboard(src) ^ Bitboard(captured) ^ Bitboard(dest);
+
+    // Knight and pawn checks are only evaded if the checker is the captured pawn
+    Bitboard attackers = (Attacks::Bishop<B>(king_index_, occupied) & (opponent.bishops | opponent.queens))
+        | (Attacks::Rook<B>(king_index_, occupied) & (opponent.rooks | opponent.queens))
+        | (checkers_ & (opponent.knights | opponent.pawns) & ~Bitboard(captured));
+    return attackers.GetBits() != 0;
+}
+
+Bitboard ChessEngine::LegalDestinations(TileIndex index, Bitboard destinations) const {
+    destinations &= check_mask_;
+    if (pinned_.BitTest(index))
+        destinations &= Attacks::Line(king_index_, index);
+    return destinations;
+}
+
+uint64_t ChessEngine::Perft(BoardState& bs, unsigned depth) {
+    if (depth == 0)
+        return 1;
+
+    MoveList moves;
+    GenerateMoves(bs, moves);
+    if (depth == 1)
+        return moves.Size();
+
+    uint64_t nodes = 0;
+    UndoRecord undo;
+    for (Move move : moves) {
+        bs.ApplyMove(move, undo);
+        nodes += Perft(bs, depth - 1);
+        bs.UndoMove(move, undo);
+    }
+    return nodes;
+}
+
+uint64_t ChessEngine::PerftCopyMake(const BoardState& bs, unsigned depth) {
+    if (depth == 0)
+        return 1;
+
+    BoardState next = bs;
+    MoveList moves;
+    GenerateMoves(next, moves);
+    if (depth == 1)
+        return moves.Size();
+
+    uint64_t nodes = 0;
+    for (Move move : moves) {
+        next = bs;
+        next.ApplyMove(move);
+        nodes += PerftCopyMake(next, depth - 1);
+    }
+    return nodes;
+}
+
+uint64_t ChessEngine::PerftPseudoLegal(BoardState& bs, unsigned depth) {
+    if (depth == 0)
+        return 1;
+
+    MoveList moves;
+    GeneratePseudoLegalMoves(bs, moves);
+    Color color = bs.GetPlayerToMove();
+
+    // Every move has to be made to be tested, so there is no bulk counting at depth 1
+    uint64_t nodes = 0;
+    UndoRecord undo;
+    for (Move move : moves) {
+        // The king can't castle out of or through check. Where it lands is tested below.
+        if (move.IsCastle()) {
+            unsigned king_index = move.GetSrcTileIndex();
+            unsigned middle_index = (king_index + move.GetDestTileIndex()) / 2;
+            if (IsSquareAttacked(bs, king_index, OtherColor(color))
+                    || IsSquareAttacked(bs, middle_index, OtherColor(color)))
+                continue;
+        }
+
+        bs.ApplyMove(move, undo);
+        unsigned king_index = bs.GetBitboards(color).king.BitscanForward();
+        if (!IsSquareAttacked(bs, king_index, OtherColor(color)))
+            nodes += PerftPseudoLegal(bs, depth - 1);
+        bs.UndoMove(move, undo);
+    }
+    return nodes;
+}
+
+// Slow reference implementation of a single ray. Move generation uses the Attacks tables instead.
 Bitboard ChessEngine::GetEmptyBoardRayAttacks(TileIndex index, Direction dir) const {
     Bitboard b(index);
 
@@ -112,203 +454,228 @@ Bitboard ChessEngine::GetRayAttacks(TileIndex index, Direction dir) const {
     return attacks;
 }
 
+template <Attacks::Backend B>
 Bitboard ChessEngine::GetRookAttacks(TileIndex index) const {
-    Bitboard attacks = GetRayAttacks(index, Direction::North);
-    attacks |= GetRayAttacks(index, Direction::South);
-    attacks |= GetRayAttacks(index, Direction::East);
-    attacks |= GetRayAttacks(index, Direction::West);
-
     // Handles cases where the first blocker was a friendly
-    return attacks & ~friendlies_;
+    return Attacks::Rook<B>(index, occupied_tiles_) & ~friendlies_;
 }
 
+template <Attacks::Backend B>
 Bitboard ChessEngine::GetBishopAttacks(TileIndex index) const {
-    Bitboard attacks = GetRayAttacks(index, Direction::NorthEast);
-    attacks |= GetRayAttacks(index, Direction::NorthWest);
-    attacks |= GetRayAttacks(index, Direction::SouthEast);
-    attacks |= GetRayAttacks(index, Direction::SouthWest);
-
     // Handles cases where the first blocker was a friendly
-    return attacks & ~friendlies_;
+    return Attacks::Bishop<B>(index, occupied_tiles_) & ~friendlies_;
 }
 
+template <Attacks::Backend B>
 Bitboard ChessEngine::GetQueenAttacks(TileIndex index) const {
-    return GetRookAttacks(index) | GetBishopAttacks(index);
+    return Attacks::Queen<B>(index, occupied_tiles_) & ~friendlies_;
 }
 
 Bitboard ChessEngine::GetKnightAttacks(TileIndex index) const {
-    int knight_rank = index.Rank();
-    int knight_file = index.File();
-    int d4_rank = TileIndex(TileName::D4).Rank();
-    int d4_file = TileIndex(TileName::D4).File();
-
-    Bitboard attacks(Bitboard::knight_pattern_d4);
-    return attacks.Shift(knight_rank - d4_rank, knight_file - d4_file);    
+    return Attacks::Knight(index);
 }
 
-// Pseudo-legal, doesn't care if the attack would place the king in check.
-// Doesn't generate castling moves.
+// Doesn't care if the attack would place the king in check, or generate castling moves
 Bitboard ChessEngine::GetKingAttacks(TileIndex index) const {
-    Bitboard attacks;
-    Bitboard king;
-
-    king.BitSet(index);
-    attacks |= king.StepNorth();
-    attacks |= king.StepSouth();
-    attacks |= king.StepEast();
-    attacks |= king.StepWest();
-    attacks |= king.StepNorthEast();
-    attacks |= king.StepNorthWest();
-    attacks |= king.StepSouthEast();
-    attacks |= king.StepSouthWest();
-
-    return attacks;
+    return Attacks::King(index);
 }
 
 
-void ChessEngine::GenerateBishopMoves(BoardState& bs) {
-    Bitboard bishops = bs.GetSelfBitboards().bishops;
+template <Color Us, Attacks::Backend B>
+void ChessEngine::GenerateBishopMoves(BoardState& bs, MoveList& moves) {
+    Bitboard bishops = bs.GetBitboards(Us).bishops;
 
     while (bishops.GetBits()) {
         unsigned bishop_index = bishops.BitscanForward();
         bishops.BitClear(bishop_index);
 
-        Bitboard attacks = GetBishopAttacks(bishop_index);
-        Bitboard quiet_moves = attacks & empty_tiles_;
-        attacks &= targets_;
+        Bitboard attacks = LegalDestinations(bishop_index, GetBishopAttacks<B>(bishop_index));
+        Bitboard quiet_moves = attacks & quiet_targets_;
+        attacks &= capture_targets_;
 
-        EnqueueMoves(bs, PieceType::Bishop, TileIndex(bishop_index), attacks, quiet_moves);    
+        EnqueueMoves(moves, TileIndex(bishop_index), attacks, quiet_moves);    
     }
 }
 
-void ChessEngine::GenerateRookMoves(BoardState& bs) {
-    Bitboard rooks = bs.GetSelfBitboards().rooks;
+template <Color Us, Attacks::Backend B>
+void ChessEngine::GenerateRookMoves(BoardState& bs, MoveList& moves) {
+    Bitboard rooks = bs.GetBitboards(Us).rooks;
 
     while (rooks.GetBits()) {
         unsigned rook_index = rooks.BitscanForward();
         rooks.BitClear(rook_index);
 
-        Bitboard attacks = GetRookAttacks(rook_index);
-        Bitboard quiet_moves = attacks &empty_tiles_;
-        attacks &= targets_;
+        Bitboard attacks = LegalDestinations(rook_index, GetRookAttacks<B>(rook_index));
+        Bitboard quiet_moves = attacks & quiet_targets_;
+        attacks &= capture_targets_;
 
-        EnqueueMoves(bs, PieceType::Rook, TileIndex(rook_index), attacks, quiet_moves);     
+        EnqueueMoves(moves, TileIndex(rook_index), attacks, quiet_moves);     
     }
 }
 
-void ChessEngine::GenerateQueenMoves(BoardState& bs) {
-    Bitboard queens = bs.GetSelfBitboards().queens;
+template <Color Us, Attacks::Backend B>
+void ChessEngine::GenerateQueenMoves(BoardState& bs, MoveList& moves) {
+    Bitboard queens = bs.GetBitboards(Us).queens;
 
     while (queens.GetBits()) {
         unsigned queen_index = queens.BitscanForward();
         queens.BitClear(queen_index);
 
-        Bitboard attacks = GetRookAttacks(queen_index) | GetBishopAttacks(queen_index);
-        Bitboard quiet_moves = attacks & empty_tiles_;
-        attacks &= targets_;
+        Bitboard attacks = LegalDestinations(queen_index, GetQueenAttacks<B>(queen_index));
+        Bitboard quiet_moves = attacks & quiet_targets_;
+        attacks &= capture_targets_;
 
-        EnqueueMoves(bs, PieceType::Queen, TileIndex(queen_index), attacks, quiet_moves);   
+        EnqueueMoves(moves, TileIndex(queen_index), attacks, quiet_moves);   
     }
 }
 
-void ChessEngine::GenerateKnightMoves(BoardState& bs) {
-    Bitboard knights = bs.GetSelfBitboards().knights;
+template <Color Us>
+void ChessEngine::GenerateKnightMoves(BoardState& bs, MoveList& moves) {
+    Bitboard knights = bs.GetBitboards(Us).knights;
 
     while (knights.GetBits()) {
         unsigned knight_index = knights.BitscanForward();
         knights.BitClear(knight_index);
 
-        Bitboard attacks = GetKnightAttacks(knight_index);
-        Bitboard quiet_moves = attacks & empty_tiles_;
-        attacks &= targets_;
+        Bitboard attacks = LegalDestinations(knight_index, GetKnightAttacks(knight_index));
+        Bitboard quiet_moves = attacks & quiet_targets_;
+        attacks &= capture_targets_;
 
-        EnqueueMoves(bs, PieceType::Knight, TileIndex(knight_index), attacks, quiet_moves);
+        EnqueueMoves(moves, TileIndex(knight_index), attacks, quiet_moves);
     }
 }
 
 
-// Doesn't generate en-passant capture or promotion moves yet
-//
-void ChessEngine::GeneratePawnMoves(BoardState& bs) {
-    Bitboard pawns = bs.GetSelfBitboards().pawns;
-
-    struct attacks_ {
-        Bitboard bb;
-        int offset;
-        bool captures;
-    } attacks[4];
-
-    if (bs.GetPlayerToMove() == Color::White) {
-        attacks[0].bb = pawns.StepNorthWest() & targets_;
-        attacks[0].offset = TileIndexOffsetFromDirection(Direction::NorthWest);
-        attacks[0].captures = true;
-        attacks[1].bb = pawns.StepNorthEast() & targets_;
-        attacks[1].offset = TileIndexOffsetFromDirection(Direction::NorthEast);
-        attacks[1].captures = true;
-        attacks[2].bb = pawns.StepNorth() & empty_tiles_;
-        attacks[2].offset = TileIndexOffsetFromDirection(Direction::North);
-        attacks[2].captures = false;
-        attacks[3].bb = attacks[2].bb.StepNorth() & empty_tiles_ & Bitboard(Bitboard::rank_4_bits);
-        attacks[3].offset = TileIndexOffsetFromDirection(Direction::North) * 2;
-        attacks[3].captures = false;
-    } else {
-        attacks[0].bb = pawns.StepSouthEast() & targets_;
-        attacks[0].offset = TileIndexOffsetFromDirection(Direction::SouthEast);
-        attacks[0].captures = true;
-        attacks[1].bb = pawns.StepSouthWest() & targets_;
-        attacks[1].offset = TileIndexOffsetFromDirection(Direction::SouthWest);
-        attacks[1].captures = true;
-        attacks[2].bb = pawns.StepSouth() & empty_tiles_;
-        attacks[2].offset = TileIndexOffsetFromDirection(Direction::South);
-        attacks[2].captures = false;
-        attacks[3].bb = attacks[2].bb.StepSouth() & empty_tiles_ & Bitboard(Bitboard::rank_5_bits);
-        attacks[3].offset = TileIndexOffsetFromDirection(Direction::South) * 2;
-        attacks[3].captures = false;
+// Pushes are quiet moves, and aren't computed at all when only captures are wanted
+template <Color Us, Attacks::Backend B>
+void ChessEngine::GeneratePawnMoves(BoardState& bs, MoveList& moves) {
+    constexpr bool white = (Us == Color::White);
+    constexpr Direction up = white ? Direction::North : Direction::South;
+    constexpr Direction up_left = white ? Direction::NorthWest : Direction::SouthEast;
+    constexpr Direction up_right = white ? Direction::NorthEast : Direction::SouthWest;
+    constexpr uint64_t double_push_rank = white ? Bitboard::rank_4_bits : Bitboard::rank_5_bits;
+
+    Bitboard pawns = bs.GetBitboards(Us).pawns;
+
+    if (gen_type_ != GenType::Quiets) {
+        EnqueuePawnMoves<Us, B>(bs, moves, pawns.Step(up_left) & capture_targets_ & check_mask_,
+            TileIndexOffsetFromDirection(up_left), Move::Capture);
+        EnqueuePawnMoves<Us, B>(bs, moves, pawns.Step(up_right) & capture_targets_ & check_mask_,
+            TileIndexOffsetFromDirection(up_right), Move::Capture);
     }
 
-    Move move;
-    move.piece_type = PieceType::Pawn;
-
-    for (int i = 0; i < 4; i++) {
-        while (attacks[i].bb.GetBits()) {
-            // To add queen promotions: if move.dest_tile_index is in the 8th rank,
-            // add two versions of this move to the list: one with a queen promotion,
-            // the other with a knight promotion. Ignore rook and bishop promotions.
-            move.dest_tile_index = attacks[i].bb.BitscanForward();
-            move.src_tile_index = move.dest_tile_index - attacks[i].offset;
-            move.captures = attacks[i].captures;
-            move_list_.push_back(move);
-            attacks[i].bb.BitClear(move.dest_tile_index);
-        }
+    if (gen_type_ != GenType::Captures) {
+        Bitboard single_pushes = pawns.Step(up) & empty_tiles_;
+        Bitboard double_pushes = single_pushes.Step(up) & empty_tiles_ & Bitboard(double_push_rank);
+        EnqueuePawnMoves<Us, B>(bs, moves, single_pushes & check_mask_,
+            TileIndexOffsetFromDirection(up), Move::Quiet);
+        EnqueuePawnMoves<Us, B>(bs, moves, double_pushes & check_mask_,
+            TileIndexOffsetFromDirection(up) * 2, Move::DoublePawnPush);
+    }
+
+    // En passant is left out of the check mask, since the checker it can capture isn't on its
+    // destination tile. It is tested move by move instead.
+    Bitboard en_passant_target = bs.GetEnPassantTarget();
+    if (gen_type_ != GenType::Quiets && en_passant_target.GetBits()) {
+        EnqueuePawnMoves<Us, B>(bs, moves, pawns.Step(up_left) & en_passant_target,
+            TileIndexOffsetFromDirection(up_left), Move::EnPassant);
+        EnqueuePawnMoves<Us, B>(bs, moves, pawns.Step(up_right) & en_passant_target,
+            TileIndexOffsetFromDirection(up_right), Move::EnPassant);
     }
 }
 
-void ChessEngine::GenerateKingMoves(BoardState& bs) {
-    unsigned king_index = bs.GetSelfBitboards().king.BitscanForward();
-    Bitboard attacks = GetKingAttacks(king_index);
-    Bitboard quiet_moves = attacks & empty_tiles_;
-    attacks &= targets_;
-    EnqueueMoves(bs, PieceType::King, king_index, attacks, quiet_moves);
+template <Color Us, Attacks::Backend B>
+void ChessEngine::EnqueuePawnMoves(BoardState& bs, MoveList& moves, Bitboard destinations, int offset,
+        unsigned flags) {
+    constexpr uint64_t promotion_rank = (Us == Color::White) ? Bitboard::rank_8_bits : Bitboard::rank_1_bits;
+
+    while (destinations.GetBits()) {
+        unsigned dest = destinations.BitscanForward();
+        unsigned src = dest - offset;
+        destinations.BitClear(dest);
+
+        if (pinned_.BitTest(src) && !Attacks::Line(king_index_, src).BitTest(dest))
+            continue;
+        if (legal_ && flags == Move::EnPassant && EnPassantExposesKing<Us, B>(bs, src, dest))
+            continue;
+
+        if (Bitboard(promotion_rank).BitTest(dest)) {
+            // Queen first, since it's almost always the best choice
+            for (int promotion = 3; promotion >= 0; promotion--)
+                moves.PushBack(Move(src, dest, flags | Move::Promotion | promotion));
+        } else {
+            moves.PushBack(Move(src, dest, flags));
+        }
+    }
 }
 
-void ChessEngine::EnqueueMoves(BoardState&bs, PieceType type, TileIndex source, 
-        Bitboard attacks, Bitboard quiet_moves) {
+template <Color Us, Attacks::Backend B>
+void ChessEngine::GenerateKingMoves(BoardState& bs, MoveList& moves) {
+    // Pseudo-legal move generation can capture a king, so it might be missing
+    Bitboard king = bs.GetBitboards(Us).king;
+    if (!king.GetBits())
+        return;
+
+    unsigned king_index = king.BitscanForward();
+    if (legal_ && gen_type_ == GenType::Captures) {
+        // The attacked tiles aren't computed for captures only. The few king captures are
+        // tested one by one instead, looking through the king as it moves away.
+        Bitboard attacks = GetKingAttacks(king_index) & capture_targets_;
+        Bitboard occupied = occupied_tiles_ ^ king;
+        Bitboard candidates = attacks;
+        while (candidates.GetBits()) {
+            unsigned dest = candidates.BitscanForward();
+            candidates.BitClear(dest);
+            if ((AttackersTo<B>(bs, dest, occupied) & targets_).GetBits())
+                attacks.BitClear(dest);
+        }
+        EnqueueMoves(moves, king_index, attacks, Bitboard());
+        return;
+    }
+
+    Bitboard attacks = GetKingAttacks(king_index) & ~king_danger_;
+    Bitboard quiet_moves = attacks & quiet_targets_;
+    attacks &= capture_targets_;
+    EnqueueMoves(moves, king_index, attacks, quiet_moves);
+
+    if (gen_type_ != GenType::Captures)
+        GenerateCastlingMoves<Us>(bs, moves);
+}
 
-    Move move;
-    move.piece_type = type;
-    move.src_tile_index = source;
+// The king can't castle out of, through or into check. Pseudo-legal generation doesn't know
+// the attacked tiles, so doesn't test this.
+template <Color Us>
+void ChessEngine::GenerateCastlingMoves(BoardState& bs, MoveList& moves) {
+    CastlingRights rights = bs.GetCastlingRights(Us);
+    if (rights.king_has_moved || checkers_.GetBits())
+        return;
+
+    // Tiles between the king and rook must be empty. Rank 1 tiles, shifted to rank 8 for black.
+    constexpr unsigned rank_offset = (Us == Color::White) ? 0 : 56;
+    constexpr Bitboard king_side_tiles = Bitboard(0x60ULL << rank_offset);   // F1, G1
+    constexpr Bitboard queen_side_tiles = Bitboard(0x0EULL << rank_offset);  // B1, C1, D1
+    constexpr Bitboard queen_side_path = Bitboard(0x0CULL << rank_offset);   // C1, D1
+    constexpr unsigned king_index = static_cast<unsigned>(TileName::E1) + rank_offset;
+
+    if (!rights.rook_h_has_moved && !(king_side_tiles & occupied_tiles_).GetBits()
+            && !(king_side_tiles & king_danger_).GetBits())
+        moves.PushBack(Move(king_index, king_index + 2, Move::KingCastle));
+
+    if (!rights.rook_a_has_moved && !(queen_side_tiles & occupied_tiles_).GetBits()
+            && !(queen_side_path & king_danger_).GetBits())
+        moves.PushBack(Move(king_index, king_index - 2, Move::QueenCastle));
+}
 
-    move.captures = true;
+void ChessEngine::EnqueueMoves(MoveList& moves, TileIndex source, Bitboard attacks, Bitboard quiet_moves) {
     while (attacks.GetBits()) {
-        move.dest_tile_index = attacks.BitscanForward();
-        move_list_.push_back(move);
-        attacks.BitClear(move.dest_tile_index);
+        unsigned dest = attacks.BitscanForward();
+        moves.PushBack(Move(source, dest, Move::Capture));
+        attacks.BitClear(dest);
     }
 
-    move.captures = false;
     while (quiet_moves.GetBits()) {
-        move.dest_tile_index = quiet_moves.BitscanForward();
-        move_list_.push_back(move);
-        quiet_moves.BitClear(move.dest_tile_index);
-    }    
+        unsigned dest = quiet_moves.BitscanForward();
+        moves.PushBack(Move(source, dest, Move::Quiet));
+        quiet_moves.BitClear(dest);
+    }
 }
@@ -0,0 +1,29 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const uint8_t* MapFile(const char* path, size_t& size) {
+    size = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    size = st.st_size;
+    return static_cast<const uint8_t*>(data);
+}
+
+void UnmapFile(const uint8_t* data, size_t size) {
+    if (data)
+        munmap(const_cast<uint8_t*>(data), size);
+}
@@ -0,0 +1,115 @@
+#include "move_picker.h"
+#include "chess_engine.h"
+
+#include <utility>
+
+MovePicker::MovePicker(ChessEngine& engine, BoardState& bs, Move hash_move)
+    : engine_(engine), bs_(bs), hash_move_(hash_move), stage_(Stage::HashMove), captures_only_(false),
+      in_check_(false), quiets_generated_(false), next_(0) {}
+
+MovePicker::MovePicker(ChessEngine& engine, BoardState& bs)
+    : engine_(engine), bs_(bs), stage_(Stage::GenerateCaptures), captures_only_(true), in_check_(false),
+      quiets_generated_(false), next_(0) {}
+
+Move MovePicker::Next() {
+    switch (stage_) {
+        case Stage::HashMove:
+            stage_ = Stage::GenerateCaptures;
+            if (!hash_move_.IsNull() && HashMoveIsGenerated())
+                return hash_move_;
+            hash_move_ = Move();
+            [[fallthrough]];
+
+        case Stage::GenerateCaptures:
+            if (stage_ == Stage::GenerateCaptures)
+                GenerateCaptures();
+            [[fallthrough]];
+
+        case Stage::Captures:
+            // Selection sort, one move at a time: a cutoff leaves the rest unsorted
+            while (next_ < moves_.Size()) {
+                unsigned best = next_;
+                for (unsigned i = next_ + 1; i < moves_.Size(); i++) {
+                    if (scores_[i] > scores_[best])
+                        best = i;
+                }
+                std::swap(moves_[next_], moves_[best]);
+                std::swap(scores_[next_], scores_[best]);
+
+                Move move = moves_[next_++];
+                if (move != hash_move_)
+                    return move;
+            }
+            stage_ = captures_only_ ? Stage::Done : Stage::GenerateQuiets;
+            if (captures_only_)
+                break;
+            [[fallthrough]];
+
+        case Stage::GenerateQuiets:
+            if (!quiets_generated_)
+                GenerateQuiets();
+            next_ = 0;
+            stage_ = Stage::Quiets;
+            [[fallthrough]];
+
+        case Stage::Quiets:
+            while (next_ < quiet_moves_.Size()) {
+                Move move = quiet_moves_[next_++];
+                if (move != hash_move_)
+                    return move;
+            }
+            stage_ = Stage::Done;
+            [[fallthrough]];
+
+        case Stage::Done:
+            break;
+    }
+    return Move();
+}
+
+bool MovePicker::InCheck() const {
+    return in_check_;
+}
+
+// Captures are generated next anyway, so checking a capture costs nothing extra. A quiet hash
+// move costs the quiet generation, which is wasted only if it cuts off.
+bool MovePicker::HashMoveIsGenerated() {
+    const MoveList* list = &moves_;
+    if (hash_move_.IsCapture()) {
+        GenerateCaptures();
+    } else {
+        GenerateQuiets();
+        list = &quiet_moves_;
+    }
+    for (Move move : *list) {
+        if (move == hash_move_)
+            return true;
+    }
+    return false;
+}
+
+// Leaves the captures ready for the Captures stage
+void MovePicker::GenerateCaptures() {
+    engine_.GenerateMoves(bs_, moves_, ChessEngine::GenType::Captures);
+    in_check_ = engine_.GetCheckers().GetBits() != 0;
+    for (unsigned i = 0; i < moves_.Size(); i++)
+        scores_[i] = MvvLvaScore(moves_[i]);
+    next_ = 0;
+    stage_ = Stage::Captures;
+}
+
+void MovePicker::GenerateQuiets() {
+    engine_.GenerateMoves(bs_, quiet_moves_, ChessEngine::GenType::Quiets);
+    quiets_generated_ = true;
+}
+
+// Victims are worth more than attackers, so any capture of a queen comes before any capture of
+// a rook, and so on. En passant is the only capture onto an empty tile.
+int MovePicker::MvvLvaScore(Move move) const {
+    PieceType victim = move.IsEnPassant() ? PieceType::Pawn : bs_.GetPieceType(move.GetDestTileIndex());
+    PieceType attacker = bs_.GetPieceType(move.GetSrcTileIndex());
+    int score = 8 * static_cast<int>(victim) - static_cast<int>(attacker);
+    if (move.IsPromotion())
+        score += 8 * static_cast<int>(move.GetPromotionType());
+    return score;
+}
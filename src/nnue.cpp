@@ -0,0 +1,527 @@
+#include "nnue.h"
+#include "board_state.h"
+#include "random.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#if defined(NNUE_SIMD)
+#include <immintrin.h>
+#endif
+
+namespace Nnue {
+
+namespace {
+
+std::unique_ptr<Network> network;
+Backend backend = Backend::Scalar;
+
+// Most rows that UpdateValues adds at once: every piece but the kings
+constexpr unsigned max_rows = 30;
+
+// out = base + the sum of the added rows - the sum of the removed rows. Every row is
+// transformed_size long. out may be the same as base.
+void UpdateValuesScalar(const int16_t* base, int16_t* out, const int16_t* const* added,
+        unsigned num_added, const int16_t* const* removed, unsigned num_removed) {
+    for (unsigned i = 0; i < transformed_size; i++) {
+        int16_t value = base[i];
+        for (unsigned row = 0; row < num_added; row++)
+            value += added[row][i];
+        for (unsigned row = 0; row < num_removed; row++)
+            value -= removed[row][i];
+        out[i] = value;
+    }
+}
+
+// Clamps the values to 0..127, as the 8-bit input of the first dense layer
+void ClampValuesScalar(const int16_t* values, uint8_t* out) {
+    for (unsigned i = 0; i < transformed_size; i++)
+        out[i] = static_cast<uint8_t>(values[i] < 0 ? 0 : (values[i] > 127 ? 127 : values[i]));
+}
+
+// out[o] = biases[o] + the dot product of input with row o of weights
+void AffineScalar(const uint8_t* input, unsigned input_size, const int8_t* weights,
+        const int32_t* biases, unsigned output_size, int32_t* out) {
+    for (unsigned o = 0; o < output_size; o++) {
+        int32_t sum = biases[o];
+        const int8_t* row = weights + o * input_size;
+        for (unsigned i = 0; i < input_size; i++)
+            sum += input[i] * row[i];
+        out[o] = sum;
+    }
+}
+
+#if defined(NNUE_SIMD)
+// The vector versions load and store transformed_size values in register sized chunks. The
+// byte products of the dense layers are summed in pairs into 16 bits by maddubs; the inputs
+// are at most 127, so the pairs can't saturate.
+__attribute__((target("ssse3")))
+void UpdateValuesSse(const int16_t* base, int16_t* out, const int16_t* const* added,
+        unsigned num_added, const int16_t* const* removed, unsigned num_removed) {
+    for (unsigned i = 0; i < transformed_size; i += 8) {
+        __m128i value = _mm_load_si128(reinterpret_cast<const __m128i*>(base + i));
+        for (unsigned row = 0; row < num_added; row++)
+            value = _mm_add_epi16(value, _mm_load_si128(reinterpret_cast<const __m128i*>(added[row] + i)));
+        for (unsigned row = 0; row < num_removed; row++)
+            value = _mm_sub_epi16(value, _mm_load_si128(reinterpret_cast<const __m128i*>(removed[row] + i)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(out + i), value);
+    }
+}
+
+__attribute__((target("ssse3")))
+void ClampValuesSse(const int16_t* values, uint8_t* out) {
+    const __m128i max_value = _mm_set1_epi16(127);
+    for (unsigned i = 0; i < transformed_size; i += 16) {
+        __m128i low = _mm_min_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(values + i)), max_value);
+        __m128i high = _mm_min_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(values + i + 8)), max_value);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(low, high));
+    }
+}
+
+// Four rows at a time, so that each chunk of input is loaded once for all four. output_size
+// must be a multiple of 4.
+__attribute__((target("ssse3")))
+void AffineSse(const uint8_t* input, unsigned input_size, const int8_t* weights,
+        const int32_t* biases, unsigned output_size, int32_t* out) {
+    const __m128i ones = _mm_set1_epi16(1);
+    for (unsigned o = 0; o < output_size; o += 4) {
+        const int8_t* row = weights + o * input_size;
+        __m128i sum0 = _mm_setzero_si128(), sum1 = sum0, sum2 = sum0, sum3 = sum0;
+        for (unsigned i = 0; i < input_size; i += 16) {
+            __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+            sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(_mm_maddubs_epi16(in,
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i))), ones));
+            sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(_mm_maddubs_epi16(in,
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + input_size + i))), ones));
+            sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_maddubs_epi16(in,
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + 2 * input_size + i))), ones));
+            sum3 = _mm_add_epi32(sum3, _mm_madd_epi16(_mm_maddubs_epi16(in,
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + 3 * input_size + i))), ones));
+        }
+        __m128i total = _mm_hadd_epi32(_mm_hadd_epi32(sum0, sum1), _mm_hadd_epi32(sum2, sum3));
+        total = _mm_add_epi32(total, _mm_loadu_si128(reinterpret_cast<const __m128i*>(biases + o)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o), total);
+    }
+}
+
+__attribute__((target("avx2")))
+void UpdateValuesAvx2(const int16_t* base, int16_t* out, const int16_t* const* added,
+        unsigned num_added, const int16_t* const* removed, unsigned num_removed) {
+    for (unsigned i = 0; i < transformed_size; i += 16) {
+        __m256i value = _mm256_load_si256(reinterpret_cast<const __m256i*>(base + i));
+        for (unsigned row = 0; row < num_added; row++)
+            value = _mm256_add_epi16(value, _mm256_load_si256(reinterpret_cast<const __m256i*>(added[row] + i)));
+        for (unsigned row = 0; row < num_removed; row++)
+            value = _mm256_sub_epi16(value, _mm256_load_si256(reinterpret_cast<const __m256i*>(removed[row] + i)));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(out + i), value);
+    }
+}
+
+__attribute__((target("avx2")))
+void ClampValuesAvx2(const int16_t* values, uint8_t* out) {
+    const __m256i max_value = _mm256_set1_epi16(127);
+    for (unsigned i = 0; i < transformed_size; i += 32) {
+        __m256i low = _mm256_min_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(values + i)), max_value);
+        __m256i high = _mm256_min_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(values + i + 16)), max_value);
+
+        // Packing works within each 128-bit lane, so the 64-bit quarters come out of order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+}
+
+__attribute__((target("avx2")))
+void AffineAvx2(const uint8_t* input, unsigned input_size, const int8_t* weights,
+        const int32_t* biases, unsigned output_size, int32_t* out) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (unsigned o = 0; o < output_size; o += 4) {
+        const int8_t* row = weights + o * input_size;
+        __m256i sum0 = _mm256_setzero_si256(), sum1 = sum0, sum2 = sum0, sum3 = sum0;
+        for (unsigned i = 0; i < input_size; i += 32) {
+            __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+            sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(_mm256_maddubs_epi16(in,
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i))), ones));
+            sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(_mm256_maddubs_epi16(in,
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + input_size + i))), ones));
+            sum2 = _mm256_add_epi32(sum2, _mm256_madd_epi16(_mm256_maddubs_epi16(in,
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + 2 * input_size + i))), ones));
+            sum3 = _mm256_add_epi32(sum3, _mm256_madd_epi16(_mm256_maddubs_epi16(in,
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + 3 * input_size + i))), ones));
+        }
+
+        // Horizontal adds leave each row's partial sums in the same position of both halves
+        __m256i total = _mm256_hadd_epi32(_mm256_hadd_epi32(sum0, sum1), _mm256_hadd_epi32(sum2, sum3));
+        __m128i result = _mm_add_epi32(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+        result = _mm_add_epi32(result, _mm_loadu_si128(reinterpret_cast<const __m128i*>(biases + o)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o), result);
+    }
+}
+#endif
+
+void UpdateValues(const int16_t* base, int16_t* out, const int16_t* const* added,
+        unsigned num_added, const int16_t* const* removed, unsigned num_removed) {
+#if defined(NNUE_SIMD)
+    if (backend == Backend::Avx2)
+        return UpdateValuesAvx2(base, out, added, num_added, removed, num_removed);
+    if (backend == Backend::Sse)
+        return UpdateValuesSse(base, out, added, num_added, removed, num_removed);
+#endif
+    UpdateValuesScalar(base, out, added, num_added, removed, num_removed);
+}
+
+void ClampValues(const int16_t* values, uint8_t* out) {
+#if defined(NNUE_SIMD)
+    if (backend == Backend::Avx2)
+        return ClampValuesAvx2(values, out);
+    if (backend == Backend::Sse)
+        return ClampValuesSse(values, out);
+#endif
+    ClampValuesScalar(values, out);
+}
+
+void Affine(const uint8_t* input, unsigned input_size, const int8_t* weights,
+        const int32_t* biases, unsigned output_size, int32_t* out) {
+#if defined(NNUE_SIMD)
+    if (backend == Backend::Avx2)
+        return AffineAvx2(input, input_size, weights, biases, output_size, out);
+    if (backend == Backend::Sse)
+        return AffineSse(input, input_size, weights, biases, output_size, out);
+#endif
+    AffineScalar(input, input_size, weights, biases, output_size, out);
+}
+
+// Shifts the layer outputs down, and clamps them to 0..127 as the next layer's input
+void Activate(const int32_t* values, unsigned size, uint8_t* out) {
+    for (unsigned i = 0; i < size; i++) {
+        int32_t value = values[i] >> weight_shift;
+        out[i] = static_cast<uint8_t>(value < 0 ? 0 : (value > 127 ? 127 : value));
+    }
+}
+
+// Computes perspective's accumulator values from the pieces on the board
+void RefreshValues(const BoardState& bs, Color perspective, unsigned king_tile, int16_t* out) {
+    const int16_t* rows[max_rows];
+    unsigned num_rows = 0;
+    const int16_t* base = network->feature_biases;
+
+    for (Color color : { Color::White, Color::Black }) {
+        const PlayerBitboards& pieces = bs.GetBitboards(color);
+        const Bitboard by_type[5] = { pieces.pawns, pieces.knights, pieces.bishops, pieces.rooks, pieces.queens };
+        for (int type = 0; type < 5; type++) {
+            uint64_t bits = by_type[type].GetBits();
+            while (bits) {
+                unsigned tile = __builtin_ctzll(bits);
+                bits &= bits - 1;
+                rows[num_rows++] = network->feature_weights[FeatureIndex(perspective, king_tile, color,
+                    static_cast<PieceType>(type), tile)];
+
+                // Only possible in positions set up with more than 32 pieces
+                if (num_rows == max_rows) {
+                    UpdateValues(base, out, rows, num_rows, nullptr, 0);
+                    base = out;
+                    num_rows = 0;
+                }
+            }
+        }
+    }
+    UpdateValues(base, out, rows, num_rows, nullptr, 0);
+}
+
+// Whether the dirty pieces of entry include perspective's king
+bool KingMoved(const Accumulator& entry, Color perspective) {
+    for (unsigned i = 0; i < entry.num_dirty; i++) {
+        if (entry.dirty[i].type == PieceType::King && entry.dirty[i].color == perspective)
+            return true;
+    }
+    return false;
+}
+
+// Computes entry's perspective values from those of the accumulator before it
+void ApplyDirty(const Accumulator& previous, Accumulator& entry, Color perspective, unsigned king_tile) {
+    const int16_t* added[Accumulator::max_dirty];
+    const int16_t* removed[Accumulator::max_dirty];
+    unsigned num_added = 0;
+    unsigned num_removed = 0;
+
+    for (unsigned i = 0; i < entry.num_dirty; i++) {
+        const DirtyPiece& piece = entry.dirty[i];
+        if (piece.type == PieceType::King)
+            continue;
+        const int16_t* row = network->feature_weights[FeatureIndex(perspective, king_tile, piece.color,
+            piece.type, piece.tile)];
+        if (piece.added)
+            added[num_added++] = row;
+        else
+            removed[num_removed++] = row;
+    }
+
+    int p = static_cast<int>(perspective);
+    UpdateValues(previous.values[p], entry.values[p], added, num_added, removed, num_removed);
+    entry.computed[p] = true;
+}
+
+int Propagate(const Accumulator& accumulator, Color to_move) {
+    alignas(64) uint8_t input[2 * transformed_size];
+    alignas(64) int32_t hidden1[hidden1_size];
+    alignas(64) uint8_t hidden1_output[hidden1_size];
+    alignas(64) int32_t hidden2[hidden2_size];
+    alignas(64) uint8_t hidden2_output[hidden2_size];
+
+    ClampValues(accumulator.values[static_cast<int>(to_move)], input);
+    ClampValues(accumulator.values[static_cast<int>(OtherColor(to_move))], input + transformed_size);
+
+    Affine(input, 2 * transformed_size, &network->hidden1_weights[0][0], network->hidden1_biases,
+        hidden1_size, hidden1);
+    Activate(hidden1, hidden1_size, hidden1_output);
+
+    Affine(hidden1_output, hidden1_size, &network->hidden2_weights[0][0], network->hidden2_biases,
+        hidden2_size, hidden2);
+    Activate(hidden2, hidden2_size, hidden2_output);
+
+    int32_t output;
+    AffineScalar(hidden2_output, hidden2_size, network->output_weights, &network->output_bias, 1, &output);
+    return output / output_scale;
+}
+
+} // namespace
+
+
+unsigned FeatureIndex(Color perspective, unsigned king_tile, Color color, PieceType type, unsigned tile) {
+    unsigned flip = (perspective == Color::White) ? 0 : 56;
+    unsigned piece = static_cast<unsigned>(type) + ((color == perspective) ? 0 : 5);
+    return (king_tile ^ flip) * num_piece_features + piece * 64 + (tile ^ flip);
+}
+
+// The file stores each value little endian, whatever the host's byte order, and the fields back
+// to back, without the struct's padding. Converted through a small buffer, since the feature
+// weights are tens of megabytes.
+template <typename T>
+bool ReadValues(FILE* file, T* values, size_t count) {
+    using U = std::make_unsigned_t<T>;
+    unsigned char buffer[4096];
+    while (count) {
+        size_t n = std::min(count, sizeof(buffer) / sizeof(T));
+        if (fread(buffer, sizeof(T), n, file) != n)
+            return false;
+        for (size_t i = 0; i < n; i++) {
+            U value = 0;
+            for (size_t b = 0; b < sizeof(T); b++)
+                value |= static_cast<U>(static_cast<U>(buffer[i * sizeof(T) + b]) << (8 * b));
+            values[i] = static_cast<T>(value);
+        }
+        values += n;
+        count -= n;
+    }
+    return true;
+}
+
+template <typename T>
+bool WriteValues(FILE* file, const T* values, size_t count) {
+    using U = std::make_unsigned_t<T>;
+    unsigned char buffer[4096];
+    while (count) {
+        size_t n = std::min(count, sizeof(buffer) / sizeof(T));
+        for (size_t i = 0; i < n; i++) {
+            U value = static_cast<U>(values[i]);
+            for (size_t b = 0; b < sizeof(T); b++)
+                buffer[i * sizeof(T) + b] = static_cast<unsigned char>(value >> (8 * b));
+        }
+        if (fwrite(buffer, sizeof(T), n, file) != n)
+            return false;
+        values += n;
+        count -= n;
+    }
+    return true;
+}
+
+// Reads or writes one field (an array of any rank, or a single value)
+template <typename Field>
+bool ReadField(FILE* file, Field& field) {
+    using T = std::remove_all_extents_t<Field>;
+    return ReadValues(file, reinterpret_cast<T*>(&field), sizeof(Field) / sizeof(T));
+}
+
+template <typename Field>
+bool WriteField(FILE* file, const Field& field) {
+    using T = std::remove_all_extents_t<Field>;
+    return WriteValues(file, reinterpret_cast<const T*>(&field), sizeof(Field) / sizeof(T));
+}
+
+bool Load(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    std::unique_ptr<Network> loaded(new Network);
+    char magic[sizeof(Network::magic)];
+    bool ok = fread(magic, sizeof(magic), 1, file) == 1
+        && memcmp(magic, Network::magic, sizeof(magic)) == 0
+        && ReadField(file, loaded->feature_biases)
+        && ReadField(file, loaded->feature_weights)
+        && ReadField(file, loaded->hidden1_biases)
+        && ReadField(file, loaded->hidden1_weights)
+        && ReadField(file, loaded->hidden2_biases)
+        && ReadField(file, loaded->hidden2_weights)
+        && ReadField(file, loaded->output_bias)
+        && ReadField(file, loaded->output_weights)
+        && fgetc(file) == EOF;
+    fclose(file);
+    if (!ok)
+        return false;
+
+    network = std::move(loaded);
+    if (backend == Backend::Scalar)
+        SetBackend(BackendSupported(Backend::Avx2) ? Backend::Avx2 : Backend::Sse);
+    return true;
+}
+
+bool Save(const char* path) {
+    if (!network)
+        return false;
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    bool ok = fwrite(Network::magic, sizeof(Network::magic), 1, file) == 1
+        && WriteField(file, network->feature_biases)
+        && WriteField(file, network->feature_weights)
+        && WriteField(file, network->hidden1_biases)
+        && WriteField(file, network->hidden1_weights)
+        && WriteField(file, network->hidden2_biases)
+        && WriteField(file, network->hidden2_weights)
+        && WriteField(file, network->output_bias)
+        && WriteField(file, network->output_weights);
+    return (fclose(file) == 0) && ok;
+}
+
+void InitRandom(uint64_t seed) {
+    uint64_t state = seed ? seed : 1;
+    auto next = [&state](int range) {
+        return static_cast<int>(XorShift64Star(state) >> 33) % (2 * range + 1) - range;
+    };
+
+    network.reset(new Network);
+    for (int16_t& bias : network->feature_biases)
+        bias = next(16);
+    for (auto& row : network->feature_weights) {
+        for (int16_t& weight : row)
+            weight = next(8);
+    }
+    for (int32_t& bias : network->hidden1_biases)
+        bias = next(1024);
+    for (auto& row : network->hidden1_weights) {
+        for (int8_t& weight : row)
+            weight = next(32);
+    }
+    for (int32_t& bias : network->hidden2_biases)
+        bias = next(1024);
+    for (auto& row : network->hidden2_weights) {
+        for (int8_t& weight : row)
+            weight = next(64);
+    }
+    network->output_bias = 0;
+    for (int8_t& weight : network->output_weights)
+        weight = next(4);
+
+    if (backend == Backend::Scalar)
+        SetBackend(BackendSupported(Backend::Avx2) ? Backend::Avx2 : Backend::Sse);
+}
+
+bool IsLoaded() {
+    return network != nullptr;
+}
+
+void Unload() {
+    network.reset();
+}
+
+bool BackendSupported(Backend candidate) {
+#if defined(NNUE_SIMD)
+    __builtin_cpu_init();
+    if (candidate == Backend::Avx2)
+        return __builtin_cpu_supports("avx2");
+    if (candidate == Backend::Sse)
+        return __builtin_cpu_supports("ssse3");
+#endif
+    return candidate == Backend::Scalar;
+}
+
+bool SetBackend(Backend new_backend) {
+    if (!BackendSupported(new_backend))
+        return false;
+    backend = new_backend;
+    return true;
+}
+
+Backend GetBackend() {
+    return backend;
+}
+
+const char* BackendName(Backend name) {
+    switch (name) {
+        case Backend::Avx2:     return "avx2";
+        case Backend::Sse:      return "sse";
+        default:                return "scalar";
+    }
+}
+
+AccumulatorStack::AccumulatorStack() : entries_(max_depth), top_(0) {
+    Reset();
+}
+
+void AccumulatorStack::Reset() {
+    top_ = 0;
+    entries_[0].computed[0] = entries_[0].computed[1] = false;
+    entries_[0].num_dirty = 0;
+}
+
+const Accumulator& AccumulatorStack::Update(const BoardState& bs) {
+    assert(network);
+    Accumulator& top = entries_[top_];
+
+    for (Color perspective : { Color::White, Color::Black }) {
+        int p = static_cast<int>(perspective);
+        if (top.computed[p])
+            continue;
+        unsigned king_tile = bs.GetBitboards(perspective).king.BitscanForward();
+
+        // Look for the nearest computed accumulator, back to the last move of this king
+        unsigned base = top_;
+        bool refresh = false;
+        while (!entries_[base].computed[p]) {
+            if (base == 0 || KingMoved(entries_[base], perspective)) {
+                refresh = true;
+                break;
+            }
+            base--;
+        }
+
+        if (refresh) {
+            RefreshValues(bs, perspective, king_tile, top.values[p]);
+            top.computed[p] = true;
+        } else {
+            for (unsigned i = base + 1; i <= top_; i++)
+                ApplyDirty(entries_[i - 1], entries_[i], perspective, king_tile);
+        }
+    }
+    return top;
+}
+
+int Evaluate(const BoardState& bs, AccumulatorStack& accumulators) {
+    return Propagate(accumulators.Update(bs), bs.GetPlayerToMove());
+}
+
+int EvaluateFromScratch(const BoardState& bs) {
+    assert(network);
+    Accumulator accumulator;
+    for (Color perspective : { Color::White, Color::Black }) {
+        unsigned king_tile = bs.GetBitboards(perspective).king.BitscanForward();
+        RefreshValues(bs, perspective, king_tile, accumulator.values[static_cast<int>(perspective)]);
+    }
+    return Propagate(accumulator, bs.GetPlayerToMove());
+}
+
+} // namespace Nnue
@@ -0,0 +1,95 @@
+#include "pawn_structure.h"
+#include "bitboard.h"
+
+namespace Evaluation {
+
+namespace {
+
+uint64_t NorthFill(uint64_t bits) {
+    bits |= bits << 8;
+    bits |= bits << 16;
+    return bits | (bits << 32);
+}
+
+uint64_t SouthFill(uint64_t bits) {
+    bits |= bits >> 8;
+    bits |= bits >> 16;
+    return bits | (bits >> 32);
+}
+
+uint64_t EastOne(uint64_t bits) {
+    return (bits << 1) & ~Bitboard::a_file_bits;
+}
+
+uint64_t WestOne(uint64_t bits) {
+    return (bits >> 1) & ~Bitboard::h_file_bits;
+}
+
+int Count(uint64_t bits) {
+    return __builtin_popcountll(bits);
+}
+
+Score Scaled(Score score, int count) {
+    return { score.mg * count, score.eg * count };
+}
+
+// Terms for the pawns in own, which move north, against the pawns in their
+Score SideScore(uint64_t own, uint64_t their) {
+    uint64_t own_behind = SouthFill(own) >> 8;          // Tiles behind own pawns
+    uint64_t own_files = NorthFill(own) | SouthFill(own);
+    uint64_t own_attack_spans = NorthFill(EastOne(own << 8) | WestOne(own << 8));
+    uint64_t their_attacks = EastOne(their >> 8) | WestOne(their >> 8);
+    uint64_t their_front_spans = SouthFill(their) >> 8;
+
+    uint64_t doubled = own & own_behind;
+    uint64_t isolated = own & ~(EastOne(own_files) | WestOne(own_files));
+    uint64_t backward = ((own << 8) & their_attacks & ~own_attack_spans) >> 8 & ~isolated;
+    uint64_t blocked = own & ((own | their) >> 8);
+    uint64_t passed = own & ~own_behind
+        & ~(their_front_spans | EastOne(their_front_spans) | WestOne(their_front_spans));
+
+    Score score = Scaled(doubled_pawn_score, Count(doubled))
+        + Scaled(isolated_pawn_score, Count(isolated))
+        + Scaled(backward_pawn_score, Count(backward))
+        + Scaled(blocked_pawn_score, Count(blocked));
+
+    // There are rarely more than one or two passed pawns
+    while (passed) {
+        score += passed_pawn_scores[__builtin_ctzll(passed) / 8];
+        passed &= passed - 1;
+    }
+    return score;
+}
+
+} // namespace
+
+// Black's pawns are scored as white's, with the board mirrored vertically
+Score PawnStructureScore(uint64_t white_pawns, uint64_t black_pawns) {
+    uint64_t mirrored_white = __builtin_bswap64(white_pawns);
+    uint64_t mirrored_black = __builtin_bswap64(black_pawns);
+    return SideScore(white_pawns, black_pawns) - SideScore(mirrored_black, mirrored_white);
+}
+
+} // namespace Evaluation
+
+
+PawnHashTable::PawnHashTable(size_t num_entries) : probes_(0), hits_(0) {
+    num_entries_ = 1;
+    while (num_entries_ * 2 <= num_entries)
+        num_entries_ *= 2;
+
+    entries_.reset(new Entry[num_entries_]);
+    Clear();
+}
+
+// An empty entry has key 0, which is also the key of a board with no pawns. The score of no
+// pawns is 0, so finding one of those is still correct.
+void PawnHashTable::Clear() {
+    for (size_t i = 0; i < num_entries_; i++)
+        entries_[i] = Entry{ 0, { 0, 0 } };
+}
+
+void PawnHashTable::ResetCounts() {
+    probes_ = 0;
+    hits_ = 0;
+}
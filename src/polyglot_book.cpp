@@ -0,0 +1,177 @@
+#include "polyglot_book.h"
+#include "chess_engine.h"
+
+#include "mapped_file.h"
+#include "polyglot_random64.h"
+
+namespace {
+
+uint64_t ReadBigEndian(const unsigned char* bytes, unsigned count) {
+    uint64_t value = 0;
+    for (unsigned i = 0; i < count; i++)
+        value = (value << 8) | bytes[i];
+    return value;
+}
+
+// Offsets into the Random64 table, after the 12 * 64 piece keys
+constexpr unsigned castling_offset = 768;
+constexpr unsigned en_passant_offset = 772;
+constexpr unsigned turn_offset = 780;
+
+} // namespace
+
+
+PolyglotBook::PolyglotBook() : data_(nullptr), size_(0) {}
+
+PolyglotBook::~PolyglotBook() {
+    Close();
+}
+
+bool PolyglotBook::Open(const char* path) {
+    Close();
+
+    size_t bytes;
+    const uint8_t* data = MapFile(path, bytes);
+    if (!data)
+        return false;
+    if (bytes % entry_size != 0) {
+        UnmapFile(data, bytes);
+        return false;
+    }
+
+    data_ = data;
+    size_ = bytes / entry_size;
+    return true;
+}
+
+void PolyglotBook::Close() {
+    UnmapFile(data_, size_ * entry_size);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+PolyglotBook::Entry PolyglotBook::GetEntry(size_t index) const {
+    const unsigned char* bytes = data_ + index * entry_size;
+    Entry entry;
+    entry.key = ReadBigEndian(bytes, 8);
+    entry.move = static_cast<uint16_t>(ReadBigEndian(bytes + 8, 2));
+    entry.weight = static_cast<uint16_t>(ReadBigEndian(bytes + 10, 2));
+    entry.learn = static_cast<uint32_t>(ReadBigEndian(bytes + 12, 4));
+    return entry;
+}
+
+size_t PolyglotBook::Probe(uint64_t key, std::vector<Entry>& entries) const {
+    // The first entry with a key not less than key
+    size_t low = 0, high = size_;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (ReadBigEndian(data_ + middle * entry_size, 8) < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    size_t count = 0;
+    for (size_t i = low; i < size_; i++, count++) {
+        Entry entry = GetEntry(i);
+        if (entry.key != key)
+            break;
+        entries.push_back(entry);
+    }
+    return count;
+}
+
+uint64_t PolyglotBook::Key(const BoardState& bs) {
+    uint64_t key = 0;
+
+    static constexpr Bitboard PlayerBitboards::* members[6] = { &PlayerBitboards::pawns,
+        &PlayerBitboards::knights, &PlayerBitboards::bishops, &PlayerBitboards::rooks,
+        &PlayerBitboards::queens, &PlayerBitboards::king };
+
+    // Pieces are numbered black pawn, white pawn, black knight... white king
+    for (Color color : { Color::Black, Color::White }) {
+        const PlayerBitboards& pieces = bs.GetBitboards(color);
+        for (int type = 0; type < 6; type++) {
+            unsigned kind = 2 * type + (color == Color::White);
+            uint64_t bits = (pieces.*members[type]).GetBits();
+            for (; bits; bits &= bits - 1)
+                key ^= polyglot_random64[64 * kind + __builtin_ctzll(bits)];
+        }
+    }
+
+    unsigned castling_index = 0;
+    for (Color color : { Color::White, Color::Black }) {
+        CastlingRights rights = bs.GetCastlingRights(color);
+        if (!rights.king_has_moved && !rights.rook_h_has_moved)
+            key ^= polyglot_random64[castling_offset + castling_index];
+        if (!rights.king_has_moved && !rights.rook_a_has_moved)
+            key ^= polyglot_random64[castling_offset + castling_index + 1];
+        castling_index += 2;
+    }
+
+    // The en passant file only counts if a pawn of the player to move is next to the pawn that
+    // double pushed, whether or not the capture is legal
+    Bitboard target = bs.GetEnPassantTarget();
+    if (target.GetBits()) {
+        Color us = bs.GetPlayerToMove();
+        Bitboard capturers = (us == Color::White) ? (target.StepSouthEast() | target.StepSouthWest())
+                                                  : (target.StepNorthEast() | target.StepNorthWest());
+        if ((capturers & bs.GetBitboards(us).pawns).GetBits())
+            key ^= polyglot_random64[en_passant_offset + target.BitscanForward() % 8];
+    }
+
+    if (bs.GetPlayerToMove() == Color::White)
+        key ^= polyglot_random64[turn_offset];
+    return key;
+}
+
+Move PolyglotBook::DecodeMove(ChessEngine& engine, BoardState& bs, uint16_t move) {
+    // Bits 0-5 are the destination tile, 6-11 the source, and 12-14 the promotion piece
+    // (1 for a knight to 4 for a queen). Tiles are numbered A1 = 0, as they are here.
+    unsigned src = (move >> 6) & 63;
+    unsigned dest = move & 63;
+    unsigned promotion = (move >> 12) & 7;
+
+    if (bs.GetPieceType(src) == PieceType::King && (src == 4 || src == 60)) {
+        if (dest == src + 3)
+            dest = src + 2;
+        else if (dest == src - 4)
+            dest = src - 2;
+    }
+
+    unsigned flags = promotion ? (Move::Promotion | (promotion - 1)) : static_cast<unsigned>(Move::Quiet);
+    Move candidate(src, dest, flags);
+    if (promotion > 4 || !engine.IsLegalMove(bs, candidate))
+        return Move();
+    return candidate;
+}
+
+Move PolyglotBook::PickMove(ChessEngine& engine, BoardState& bs, uint64_t key, uint64_t random) const {
+    std::vector<Entry> entries;
+    std::vector<Move> moves;
+    uint64_t total_weight = 0;
+
+    Probe(key, entries);
+    for (const Entry& entry : entries) {
+        Move move = entry.weight ? DecodeMove(engine, bs, entry.move) : Move();
+        moves.push_back(move);
+        if (!move.IsNull())
+            total_weight += entry.weight;
+    }
+    if (total_weight == 0)
+        return Move();
+
+    uint64_t pick = random % total_weight;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (moves[i].IsNull())
+            continue;
+        if (pick < entries[i].weight)
+            return moves[i];
+        pick -= entries[i].weight;
+    }
+    return Move();
+}
+
+Move PolyglotBook::PickMove(ChessEngine& engine, BoardState& bs, uint64_t random) const {
+    return PickMove(engine, bs, Key(bs), random);
+}
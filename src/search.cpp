@@ -0,0 +1,272 @@
+#include "search.h"
+#include "bitbase.h"
+#include "chess_engine.h"
+#include "move_picker.h"
+
+#include <cstdlib>
+
+Search::Search(ChessEngine& engine, TranspositionTable& tt, unsigned thread_id,
+        const std::atomic<bool>* stop_signal)
+    : engine_(engine), tt_(tt), thread_id_(thread_id), stop_signal_(stop_signal), nodes_(0),
+      evaluator_(Evaluator::Classical), pawn_table_(nullptr), use_bitbases_(false), can_stop_(false),
+      stopped_(false) {}
+
+SearchResult Search::Run(BoardState& bs, const SearchLimits& limits) {
+    SearchResult result;
+    limits_ = limits;
+    start_ = Clock::now();
+    nodes_ = 0;
+    can_stop_ = false;
+    stopped_ = false;
+
+    // The accumulators are attached for this search only, so that the caller's later moves
+    // don't update them
+    evaluator_ = engine_.GetEvaluator();
+    Nnue::AccumulatorStack* caller_accumulators = bs.GetAccumulators();
+    if (evaluator_ == Evaluator::Nnue) {
+        if (!accumulators_)
+            accumulators_.reset(new Nnue::AccumulatorStack);
+        accumulators_->Reset();
+        bs.SetAccumulators(accumulators_.get());
+    }
+    pawn_table_ = &engine_.GetPawnHashTable();
+    use_bitbases_ = Bitbase::AnyLoaded();
+    uint64_t start_pawn_probes = pawn_table_->GetProbes();
+    uint64_t start_pawn_hits = pawn_table_->GetHits();
+
+    unsigned max_depth = (limits.depth && limits.depth < max_search_ply) ? limits.depth : max_search_ply;
+    uint64_t prev_iteration_nodes = 0;
+
+    // Odd numbered helper threads skip the first iteration, so that from then on they're a
+    // ply ahead of (and filling the table for) the main thread
+    for (unsigned depth = 1 + (thread_id_ & 1); depth <= max_depth; depth++) {
+        uint64_t iteration_start_nodes = nodes_;
+        double iteration_start_seconds = SecondsElapsed();
+
+        int score = Negamax(bs, depth, 0, -infinite_score, infinite_score);
+        if (stopped_)
+            break;
+
+        result.score = score;
+        result.depth = depth;
+        result.pv.assign(pv_[0], pv_[0] + pv_length_[0]);
+        if (!result.pv.empty())
+            result.best_move = result.pv[0];
+        can_stop_ = true;
+
+        // A forced mate that this depth fully searches can't get any shorter
+        if (IsMateScore(score) && mate_score - abs(score) <= static_cast<int>(depth))
+            break;
+
+        // Predict the next iteration from the growth of this one over the last: the effective
+        // branching factor. A fixed node limit doesn't predict, so that it stays deterministic.
+        uint64_t iteration_nodes = nodes_ - iteration_start_nodes;
+        double iteration_seconds = SecondsElapsed() - iteration_start_seconds;
+        if (limits.seconds > 0 && prev_iteration_nodes > 0) {
+            double branching = static_cast<double>(iteration_nodes) / prev_iteration_nodes;
+            double predicted = iteration_seconds * (branching > 1 ? branching : 1);
+            if (SecondsElapsed() + predicted > limits.seconds)
+                break;
+        }
+        prev_iteration_nodes = iteration_nodes;
+    }
+
+    bs.SetAccumulators(caller_accumulators);
+    result.nodes = nodes_;
+    result.seconds = SecondsElapsed();
+    result.pawn_hash_probes = pawn_table_->GetProbes() - start_pawn_probes;
+    result.pawn_hash_hits = pawn_table_->GetHits() - start_pawn_hits;
+    return result;
+}
+
+int Search::Negamax(BoardState& bs, int depth, unsigned ply, int alpha, int beta) {
+    if (depth <= 0 || ply >= max_search_ply)
+        return Quiescence(bs, ply, alpha, beta);
+
+    if (ShouldStop())
+        return 0;
+
+    nodes_++;
+    pv_length_[ply] = ply;
+
+    // A bitbase draw is exact, so there is nothing to search. Wins are still searched, to find
+    // the way to mate.
+    if (use_bitbases_ && ply > 0 && Bitbase::Probe(bs) == Bitbase::Result::Draw)
+        return 0;
+
+    // The root always searches, so that it has a best move and a PV
+    uint64_t key = bs.GetHashKey();
+    TranspositionTable::Entry entry;
+    Move hash_move;
+    if (tt_.Probe(key, entry)) {
+        hash_move = entry.move;
+        int score = ScoreFromTable(entry.score, ply);
+        if (ply > 0 && entry.depth >= depth) {
+            if (entry.bound == TranspositionTable::Bound::Exact)
+                return score;
+            if (entry.bound == TranspositionTable::Bound::Lower && score >= beta)
+                return score;
+            if (entry.bound == TranspositionTable::Bound::Upper && score <= alpha)
+                return score;
+        }
+    }
+
+    MovePicker picker(engine_, bs, hash_move);
+    int alpha_orig = alpha;
+    int best_score = -infinite_score;
+    Move best_move;
+    UndoRecord undo;
+    unsigned move_count = 0;
+
+    for (Move move = picker.Next(); !move.IsNull(); move = picker.Next()) {
+        move_count++;
+        bs.ApplyMove(move, undo);
+        int score = -Negamax(bs, depth - 1, ply + 1, -beta, -alpha);
+        bs.UndoMove(move, undo);
+        if (stopped_)
+            return 0;
+
+        if (score > best_score) {
+            best_score = score;
+            best_move = move;
+            if (score > alpha) {
+                alpha = score;
+                UpdatePv(ply, move);
+                if (alpha >= beta)
+                    break;
+            }
+        }
+    }
+
+    // With no legal moves, the player to move is either mated or stalemated
+    if (move_count == 0)
+        return picker.InCheck() ? -mate_score + static_cast<int>(ply) : 0;
+
+    TranspositionTable::Bound bound = TranspositionTable::Bound::Exact;
+    if (best_score >= beta)
+        bound = TranspositionTable::Bound::Lower;
+    else if (best_score <= alpha_orig)
+        bound = TranspositionTable::Bound::Upper;
+
+    // After a fail low every move scored below alpha, so none of them is known to be best
+    tt_.Store(key, (bound == TranspositionTable::Bound::Upper) ? Move() : best_move,
+        ScoreToTable(best_score, ply), depth, bound);
+
+    return best_score;
+}
+
+// Fail-soft, like Negamax. Nodes here are counted too, and usually outnumber the rest.
+int Search::Quiescence(BoardState& bs, unsigned ply, int alpha, int beta) {
+    if (ShouldStop())
+        return 0;
+
+    nodes_++;
+    pv_length_[ply] = ply;
+
+    if (ply >= max_search_ply)
+        return Evaluate(bs);
+
+    // In check there is no standing pat, since the check may be mate: every evasion is
+    // searched, not only captures. (The engine's checkers are those of the last position it
+    // generated moves for, so the king is tested directly.)
+    bool in_check = engine_.IsOwnKingInCheck(bs);
+    int best_score = -infinite_score;
+    if (!in_check) {
+        best_score = Evaluate(bs);
+        if (best_score >= beta)
+            return best_score;
+        if (best_score > alpha)
+            alpha = best_score;
+    }
+
+    MovePicker picker = in_check ? MovePicker(engine_, bs, Move()) : MovePicker(engine_, bs);
+    UndoRecord undo;
+    unsigned move_count = 0;
+
+    for (Move move = picker.Next(); !move.IsNull(); move = picker.Next()) {
+        move_count++;
+        bs.ApplyMove(move, undo);
+        int score = -Quiescence(bs, ply + 1, -beta, -alpha);
+        bs.UndoMove(move, undo);
+        if (stopped_)
+            return 0;
+
+        if (score > best_score) {
+            best_score = score;
+            if (score > alpha) {
+                alpha = score;
+                if (alpha >= beta)
+                    break;
+            }
+        }
+    }
+
+    if (in_check && move_count == 0)
+        return -mate_score + static_cast<int>(ply);
+    return best_score;
+}
+
+// A bitbase result overrides the evaluation: a draw scores 0, and a known win is worth more
+// than any material, while still preferring the positions the evaluation scores higher
+int Search::Evaluate(BoardState& bs) {
+    int score;
+    if (evaluator_ == Evaluator::Nnue) {
+        score = Nnue::Evaluate(bs, *accumulators_);
+    } else {
+        score = bs.GetEvaluation(*pawn_table_);
+        if (bs.GetPlayerToMove() == Color::Black)
+            score = -score;
+    }
+
+    if (use_bitbases_) {
+        switch (Bitbase::Probe(bs)) {
+        case Bitbase::Result::Draw:
+            return 0;
+        case Bitbase::Result::Win:
+            return score + bitbase_win_score;
+        case Bitbase::Result::Loss:
+            return score - bitbase_win_score;
+        default:
+            break;
+        }
+    }
+    return score;
+}
+
+// The node limit is checked at every node, so a node limited search is reproducible. The clock
+// is only read every 1024 nodes, since that is comparatively slow.
+bool Search::ShouldStop() {
+    if (stop_signal_ && stop_signal_->load(std::memory_order_relaxed))
+        stopped_ = true;
+    if (stopped_ || !can_stop_)
+        return stopped_;
+
+    if (limits_.nodes && nodes_ >= limits_.nodes)
+        stopped_ = true;
+    else if (limits_.seconds > 0 && (nodes_ & 1023) == 0 && SecondsElapsed() >= limits_.seconds)
+        stopped_ = true;
+    return stopped_;
+}
+
+double Search::SecondsElapsed() const {
+    return std::chrono::duration<double>(Clock::now() - start_).count();
+}
+
+void Search::UpdatePv(unsigned ply, Move move) {
+    pv_[ply][ply] = move;
+    for (unsigned i = ply + 1; i < pv_length_[ply + 1]; i++)
+        pv_[ply][i] = pv_[ply + 1][i];
+    pv_length_[ply] = (pv_length_[ply + 1] > ply + 1) ? pv_length_[ply + 1] : ply + 1;
+}
+
+int Search::ScoreToTable(int score, unsigned ply) {
+    if (IsMateScore(score))
+        return (score > 0) ? score + static_cast<int>(ply) : score - static_cast<int>(ply);
+    return score;
+}
+
+int Search::ScoreFromTable(int score, unsigned ply) {
+    if (IsMateScore(score))
+        return (score > 0) ? score - static_cast<int>(ply) : score + static_cast<int>(ply);
+    return score;
+}
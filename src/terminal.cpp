@@ -1,6 +1,7 @@
 #include "chess_common.h"
 #include "terminal.h"
 
+#include <cstdio>
 #include <iostream>
 #include <string>
 
@@ -36,6 +37,29 @@ void Terminal::PrintMessage(const char* msg) {
     puts(msg);
 }
 
+void Terminal::PrintSearchResult(const SearchResult& result) {
+    printf("depth %u  score %+d  nodes %llu  time %.3f s", result.depth, result.score,
+        (unsigned long long)result.nodes, result.seconds);
+    if (result.pawn_hash_probes)
+        printf("  pawn hash %.1f%%", 100.0 * result.pawn_hash_hits / result.pawn_hash_probes);
+    printf("  pv");
+    for (Move move : result.pv)
+        printf(" %s", MoveToText(move).c_str());
+    puts("");
+}
+
+// Long algebraic notation, the same as the player enters moves: e.g. "e2e4", or "e7e8q"
+std::string Terminal::MoveToText(Move move) {
+    std::string text;
+    for (unsigned index : { move.GetSrcTileIndex(), move.GetDestTileIndex() }) {
+        text += static_cast<char>('a' + index % 8);
+        text += static_cast<char>('1' + index / 8);
+    }
+    if (move.IsPromotion())
+        text += "nbrq"[static_cast<int>(move.GetPromotionType()) - static_cast<int>(PieceType::Knight)];
+    return text;
+}
+
 void Terminal::PrintBoard(const BoardState& bs) {
     TileContents board[TileIndex::num_tiles];
     for (int i = 0; i < TileIndex::num_tiles; i++) {
@@ -71,8 +95,8 @@ void Terminal::PrintBoard(const BoardState& bs) {
     for (int file = 0; file < 8; file++) {
         printf("%c ", 'a' + file);
     }
-    double evaluation = bs.GetEvaluation();
-    printf("\nEvaluation: %s%.1f\n", evaluation > 0 ? "+" : "", evaluation);
+    double evaluation = bs.GetEvaluation() / 100.0;
+    printf("\nEvaluation: %s%.2f\n", evaluation > 0 ? "+" : "", evaluation);
     printf("%s to move: \n\n", bs.GetPlayerToMove() == Color::White ? "WHITE" : "BLACK");
 }
 
@@ -86,6 +110,8 @@ int Terminal::TileIndexFromText(char file, char rank) {
     return -1;
 }
 
+// Moves are entered as source and destination tiles, e.g. "e2e4". Promotions can add the
+// piece letter, e.g. "e7e8n"; otherwise the pawn promotes to a queen.
 Move Terminal::GetPlayerMove() {
     Move mv;
     std::string input;
@@ -93,13 +119,13 @@ Move Terminal::GetPlayerMove() {
     while (true) {
         std::getline(std::cin, input);
 
-        if (input.size() == 4) {
+        if (input.size() == 4 || input.size() == 5) {
             int from = TileIndexFromText(input[0], input[1]);
             int to = TileIndexFromText(input[2], input[3]);
+            int promotion = (input.size() == 5) ? PromotionFromText(input[4]) : -1;
 
-            if (to > 0 && from > 0) {
-                mv.src_tile_index = from;
-                mv.dest_tile_index = to;
+            if (to >= 0 && from >= 0 && (input.size() == 4 || promotion >= 0)) {
+                mv = Move(from, to, (promotion >= 0) ? Move::Promotion | promotion : Move::Quiet);
                 std::cout << "Parsed move from/to indexes " << from << "/" << to << std::endl; 
                 break;
             }
@@ -109,4 +135,15 @@ Move Terminal::GetPlayerMove() {
     }
 
     return mv;
-}
\ No newline at end of file
+}
+
+// Returns the promoted piece's offset from PieceType::Knight, or -1 if invalid
+int Terminal::PromotionFromText(char piece) {
+    switch (piece) {
+        case 'n':   return 0;
+        case 'b':   return 1;
+        case 'r':   return 2;
+        case 'q':   return 3;
+    }
+    return -1;
+}
@@ -0,0 +1,81 @@
+#include "transposition_table.h"
+
+TranspositionTable::TranspositionTable(size_t size_mb) : num_buckets_(0), age_(0) {
+    Resize(size_mb);
+}
+
+void TranspositionTable::Resize(size_t size_mb) {
+    size_t max_buckets = (size_mb * 1024 * 1024) / sizeof(Bucket);
+
+    num_buckets_ = 1;
+    while (num_buckets_ * 2 <= max_buckets)
+        num_buckets_ *= 2;
+
+    buckets_.reset(new Bucket[num_buckets_]);
+    Clear();
+}
+
+void TranspositionTable::Clear() {
+    for (size_t i = 0; i < num_buckets_; i++) {
+        for (Slot& slot : buckets_[i].slots) {
+            slot.key_xor_data.store(0, std::memory_order_relaxed);
+            slot.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    age_ = 0;
+}
+
+size_t TranspositionTable::GetSizeBytes() const {
+    return num_buckets_ * sizeof(Bucket);
+}
+
+void TranspositionTable::NewSearch() {
+    age_ = (age_ + 1) & age_mask;
+}
+
+void TranspositionTable::Store(uint64_t key, Move move, int score, unsigned depth, Bound bound) {
+    Bucket& bucket = GetBucket(key);
+    Slot* replace = nullptr;
+    int replace_worth = 0;
+
+    for (Slot& slot : bucket.slots) {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+
+        if ((slot.key_xor_data.load(std::memory_order_relaxed) ^ data) == key) {
+            // Same position: always overwrite, but don't lose a known best move
+            if (move.IsNull())
+                move = Unpack(data).move;
+            replace = &slot;
+            break;
+        }
+
+        // Each search generation of age counts as much as 8 plies of depth. Empty entries
+        // have depth 0 and the oldest possible age, so they're taken first.
+        unsigned age_difference = (age_ - AgeOf(data)) & age_mask;
+        if (Unpack(data).bound == Bound::None)
+            age_difference = age_mask;
+        int worth = static_cast<int>(Unpack(data).depth) - 8 * static_cast<int>(age_difference);
+        if (!replace || worth < replace_worth) {
+            replace = &slot;
+            replace_worth = worth;
+        }
+    }
+
+    uint64_t data = Pack(move, score, depth, bound, age_);
+    replace->key_xor_data.store(key ^ data, std::memory_order_relaxed);
+    replace->data.store(data, std::memory_order_relaxed);
+}
+
+unsigned TranspositionTable::GetHashfull() const {
+    constexpr size_t sample_buckets = 250;    // 1000 entries
+    size_t buckets = (num_buckets_ < sample_buckets) ? num_buckets_ : sample_buckets;
+    unsigned used = 0;
+
+    for (size_t i = 0; i < buckets; i++) {
+        for (const Slot& slot : buckets_[i].slots) {
+            uint64_t data = slot.data.load(std::memory_order_relaxed);
+            used += (Unpack(data).bound != Bound::None && AgeOf(data) == age_);
+        }
+    }
+    return used * 1000 / (buckets * entries_per_bucket);
+}
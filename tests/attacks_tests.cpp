@@ -0,0 +1,148 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/SimpleString.h"
+
+// So we can check the value of private members
+#define private public
+#include "chess_engine.h"
+#undef private
+
+#include "attacks.h"
+#include "test_utils.h"
+
+
+TEST_GROUP(Attacks_Tests)
+{
+    ChessEngine engine;     // Reference ray attacks, and initializes the attack tables
+    uint64_t rng_state;
+
+    void setup() {
+        rng_state = 0x9E3779B97F4A7C15ULL;
+    }
+    void teardown() {}
+
+    // Sparse pseudo-random occupancy
+    Bitboard RandomOccupancy() {
+        return Bitboard(XorShift64Star(rng_state) & XorShift64Star(rng_state));
+    }
+
+    Bitboard ReferenceAttacks(TileIndex index, Direction (&dirs)[4]) {
+        Bitboard attacks;
+        for (Direction d : dirs)
+            attacks |= engine.GetRayAttacks(index, d);
+        return attacks;
+    }
+
+    // Compares one backend's tables against the reference rays
+    template <Attacks::Backend B>
+    void CheckBackend() {
+        Direction rook_dirs[4] = { Direction::North, Direction::South, Direction::East, Direction::West };
+        Direction bishop_dirs[4] = { Direction::NorthEast, Direction::NorthWest, Direction::SouthEast, Direction::SouthWest };
+
+        for (unsigned i = 0; i < TileIndex::num_tiles; i++) {
+            for (int n = 0; n < 50; n++) {
+                Bitboard occupied = RandomOccupancy();
+                engine.occupied_tiles_ = occupied;
+                CHECK_EQUAL(ReferenceAttacks(i, rook_dirs), Attacks::Rook<B>(i, occupied));
+                CHECK_EQUAL(ReferenceAttacks(i, bishop_dirs), Attacks::Bishop<B>(i, occupied));
+                CHECK_EQUAL(Attacks::Rook<B>(i, occupied) | Attacks::Bishop<B>(i, occupied), Attacks::Queen<B>(i, occupied));
+            }
+        }
+    }
+};
+
+TEST(Attacks_Tests, EmptyBoard)
+{
+    TileIndex d4 = TileName::D4;
+    Bitboard rook = Bitboard(Bitboard::rank_4_bits) ^ Bitboard(Bitboard::a_file_bits << 3);
+    Bitboard bishop = Bitboard(0x8041221400142241ULL);
+
+    CHECK_EQUAL(rook, Attacks::Rook(d4, Bitboard(0)));
+    CHECK_EQUAL(bishop, Attacks::Bishop(d4, Bitboard(0)));
+    CHECK_EQUAL(rook | bishop, Attacks::Queen(d4, Bitboard(0)));
+}
+
+TEST(Attacks_Tests, MatchesRayAttacks)
+{
+    Direction rook_dirs[4] = { Direction::North, Direction::South, Direction::East, Direction::West };
+    Direction bishop_dirs[4] = { Direction::NorthEast, Direction::NorthWest,
+        Direction::SouthEast, Direction::SouthWest };
+
+    for (int i = 0; i < 1000; i++) {
+        Bitboard occupied = RandomOccupancy();
+        engine.occupied_tiles_ = occupied;
+
+        for (unsigned index = 0; index < TileIndex::num_tiles; index++) {
+            CHECK_EQUAL(ReferenceAttacks(index, rook_dirs), Attacks::Rook(index, occupied));
+            CHECK_EQUAL(ReferenceAttacks(index, bishop_dirs), Attacks::Bishop(index, occupied));
+        }
+    }
+}
+
+// The leaper tables are built at compile time
+static_assert(Attacks::knight_table[static_cast<int>(TileName::D4)] == Bitboard(0x0000142200221400ULL),
+    "knight table");
+
+TEST(Attacks_Tests, Knight)
+{
+    using Idx = TileName;
+    CHECK_EQUAL(Bitboard(Idx::B3) | Bitboard(Idx::C2), Attacks::Knight(Idx::A1));
+    CHECK_EQUAL(Bitboard(Idx::F7) | Bitboard(Idx::G6), Attacks::Knight(Idx::H8));
+    CHECK_EQUAL(Bitboard(Idx::C1) | Bitboard(Idx::C3) | Bitboard(Idx::D4) | Bitboard(Idx::F4)
+        | Bitboard(Idx::G3) | Bitboard(Idx::G1), Attacks::Knight(Idx::E2));
+}
+
+TEST(Attacks_Tests, King)
+{
+    using Idx = TileName;
+    CHECK_EQUAL(Bitboard(Idx::A2) | Bitboard(Idx::B2) | Bitboard(Idx::B1), Attacks::King(Idx::A1));
+    CHECK_EQUAL(Bitboard(0x0000001C141C0000ULL), Attacks::King(Idx::D4));
+}
+
+TEST(Attacks_Tests, Pawn)
+{
+    using Idx = TileName;
+    CHECK_EQUAL(Bitboard(Idx::D5) | Bitboard(Idx::F5), Attacks::Pawn(Color::White, Idx::E4));
+    CHECK_EQUAL(Bitboard(Idx::D3) | Bitboard(Idx::F3), Attacks::Pawn(Color::Black, Idx::E4));
+    CHECK_EQUAL(Bitboard(Idx::B3), Attacks::Pawn(Color::White, Idx::A2));
+    CHECK_EQUAL(Bitboard(Idx::G6), Attacks::Pawn(Color::Black, Idx::H7));
+}
+
+TEST(Attacks_Tests, Between)
+{
+    using Idx = TileName;
+    CHECK_EQUAL(Bitboard(Idx::B2) | Bitboard(Idx::C3), Attacks::Between(Idx::A1, Idx::D4));
+    CHECK_EQUAL(Bitboard(Idx::B2) | Bitboard(Idx::C3), Attacks::Between(Idx::D4, Idx::A1));
+    CHECK_EQUAL(Bitboard(Idx::E2) | Bitboard(Idx::E3), Attacks::Between(Idx::E1, Idx::E4));
+    CHECK_EQUAL(Bitboard(0), Attacks::Between(Idx::E1, Idx::E2));
+    CHECK_EQUAL(Bitboard(0), Attacks::Between(Idx::A1, Idx::B3));
+}
+
+TEST(Attacks_Tests, Line)
+{
+    using Idx = TileName;
+    CHECK_EQUAL(Bitboard(0x8040201008040201ULL), Attacks::Line(Idx::C3, Idx::F6));
+    CHECK_EQUAL(Bitboard(Bitboard::a_file_bits << 4), Attacks::Line(Idx::E8, Idx::E2));
+    CHECK_EQUAL(Bitboard(Bitboard::rank_3_bits), Attacks::Line(Idx::H3, Idx::A3));
+    CHECK_EQUAL(Bitboard(0), Attacks::Line(Idx::A1, Idx::B3));
+
+    for (unsigned a = 0; a < TileIndex::num_tiles; a++) {
+        for (unsigned b = 0; b < TileIndex::num_tiles; b++) {
+            // Between is always a subset of line
+            CHECK_EQUAL(Bitboard(0), Attacks::Between(a, b) & ~Attacks::Line(a, b));
+        }
+    }
+}
+
+TEST(Attacks_Tests, Backends)
+{
+    // Every backend this machine supports gives the same attacks as the reference rays
+    CheckBackend<Attacks::Backend::Magic>();
+    if (Attacks::PextSupported())
+        CheckBackend<Attacks::Backend::Pext>();
+
+    Attacks::Backend initial = Attacks::GetBackend();
+    CHECK_EQUAL(Attacks::PextSupported(), Attacks::SetBackend(Attacks::Backend::Pext));
+    CHECK(Attacks::SetBackend(Attacks::Backend::Magic));
+    CHECK(Attacks::GetBackend() == Attacks::Backend::Magic);
+    CHECK(Attacks::SetBackend(initial));
+}
@@ -0,0 +1,65 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/SimpleString.h"
+
+#include "batch_evaluation.h"
+#include "board_state.h"
+#include "chess_engine.h"
+#include "test_utils.h"
+
+#include <vector>
+
+
+TEST_GROUP(BatchEvaluation_Tests)
+{
+    std::vector<BoardState> positions;
+    Evaluation::PositionBatch batch;
+
+    // Positions along pseudo-random games from a few starting points, so that the batch has a
+    // mix of material and phases (including promoted pieces)
+    void setup() {
+        const char* const fens[] = {
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        };
+
+        for (const char* fen : fens) {
+            for (const BoardState& bs : RandomGamePositions(fen, 100)) {
+                positions.push_back(bs);
+                batch.Add(bs);
+            }
+        }
+    }
+    void teardown() {}
+
+    void CheckBackend(Evaluation::BatchBackend backend) {
+        std::vector<int> scores(batch.Size());
+        CHECK(Evaluation::EvaluateBatch(batch, scores.data(), backend));
+        for (size_t i = 0; i < positions.size(); i++)
+            CHECK_EQUAL(positions[i].GetEvaluation(), scores[i]);
+    }
+};
+
+TEST(BatchEvaluation_Tests, MatchesGetEvaluation)
+{
+    // An odd count, so that the vector backend finishes with the scalar one
+    batch.Add(positions.back());
+    positions.push_back(positions.back());
+    CHECK(batch.Size() % 8 != 0);
+
+    CheckBackend(Evaluation::BatchBackend::Scalar);
+    if (Evaluation::Avx2Supported())
+        CheckBackend(Evaluation::BatchBackend::Avx2);
+}
+
+TEST(BatchEvaluation_Tests, Clear)
+{
+    batch.Clear();
+    CHECK_EQUAL(0, batch.Size());
+
+    BoardState bs;
+    batch.Add(bs);
+    int score = 1;
+    Evaluation::EvaluateBatch(batch, &score);
+    CHECK_EQUAL(bs.GetEvaluation(), score);
+}
@@ -0,0 +1,166 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/SimpleString.h"
+
+#include "bitbase.h"
+#include "board_state.h"
+#include "chess_engine.h"
+#include "search.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using Bitbase::Endgame;
+using Bitbase::Result;
+
+namespace {
+
+struct GeneratedBitbases {
+    std::vector<uint8_t> kqk, krk, kpk;
+};
+
+// Generating takes seconds, so each endgame is generated once and shared by all the tests. The
+// tables are kept until exit, so they are allocated with the leak detector off.
+const GeneratedBitbases& Generated() {
+    static const GeneratedBitbases* generated = [] {
+        MemoryLeakWarningPlugin::saveAndDisableNewDeleteOverloads();
+        GeneratedBitbases* g = new GeneratedBitbases;
+        g->kqk = Bitbase::Generate(Endgame::Kqk, 3);
+        g->krk = Bitbase::Generate(Endgame::Krk, 3);
+        g->kpk = Bitbase::Generate(Endgame::Kpk, 3, &g->kqk, &g->krk);
+        MemoryLeakWarningPlugin::restoreNewDeleteOverloads();
+        return g;
+    }();
+    return *generated;
+}
+
+} // namespace
+
+TEST_GROUP(Bitbase_Tests)
+{
+    const char* directory = "bitbase_tests";
+
+    void teardown() {
+        Bitbase::Unload();
+        for (Endgame endgame : { Endgame::Kpk, Endgame::Krk, Endgame::Kqk })
+            remove((std::string(directory) + "/" + Bitbase::FileName(endgame)).c_str());
+        rmdir(directory);
+    }
+
+    // Saves and loads all three endgames
+    void GenerateAndLoad() {
+        mkdir(directory, 0755);
+        CHECK(Bitbase::Save(Generated().kqk, (std::string(directory) + "/kqk.bin").c_str()));
+        CHECK(Bitbase::Save(Generated().krk, (std::string(directory) + "/krk.bin").c_str()));
+        CHECK(Bitbase::Save(Generated().kpk, (std::string(directory) + "/kpk.bin").c_str()));
+        CHECK_EQUAL(3, Bitbase::Load(directory));
+    }
+
+    Result Probe(const char* fen) {
+        return Bitbase::Probe(BoardState(fen));
+    }
+};
+
+TEST(Bitbase_Tests, Generate)
+{
+    // The result doesn't depend on how the work is split
+    std::vector<uint8_t> one_thread = Bitbase::Generate(Endgame::Kqk, 1);
+    CHECK_EQUAL(Bitbase::file_size, one_thread.size());
+    CHECK(one_thread == Generated().kqk);
+
+    // Kb6 and Qc7 against Ka8 mates with white to move, and is stalemate with black to move
+    auto IsWin = [&](uint32_t index) { return (one_thread[index >> 3] >> (index & 7)) & 1; };
+    CHECK(IsWin(Bitbase::Index(41, 56, 50, true)));
+    CHECK_FALSE(IsWin(Bitbase::Index(41, 56, 50, false)));
+}
+
+TEST(Bitbase_Tests, Load)
+{
+    CHECK_FALSE(Bitbase::AnyLoaded());
+    CHECK(Result::Unknown == Probe("k7/8/1K6/8/8/8/8/1Q6 w - - 0 1"));
+    CHECK_EQUAL(0, Bitbase::Load("no_such_directory"));
+
+    // A file of the wrong size isn't loaded
+    mkdir(directory, 0755);
+    std::vector<uint8_t> short_file(Bitbase::file_size - 1);
+    CHECK(Bitbase::Save(short_file, (std::string(directory) + "/krk.bin").c_str()));
+    CHECK_EQUAL(0, Bitbase::Load(directory));
+
+    GenerateAndLoad();
+    CHECK(Bitbase::IsLoaded(Endgame::Kpk));
+    CHECK(Bitbase::IsLoaded(Endgame::Krk));
+    CHECK(Bitbase::IsLoaded(Endgame::Kqk));
+
+    Bitbase::Unload();
+    CHECK_FALSE(Bitbase::AnyLoaded());
+}
+
+TEST(Bitbase_Tests, Probe)
+{
+    GenerateAndLoad();
+
+    // Stalemated, and with the rook free to move away
+    CHECK(Result::Draw == Probe("k7/8/K7/8/8/8/8/1R6 b - - 0 1"));
+    CHECK(Result::Win == Probe("k7/8/K7/8/8/8/8/1R6 w - - 0 1"));
+
+    // Black is the strong side. The white king takes the undefended queen, but not the defended one.
+    CHECK(Result::Draw == Probe("8/8/8/8/8/8/1q6/K6k w - - 0 1"));
+    CHECK(Result::Loss == Probe("8/8/8/8/8/2k5/1q6/K7 w - - 0 1"));
+
+    // The king in front of its pawn: with the opposition it wins, without it draws. On the
+    // sixth rank it wins either way.
+    CHECK(Result::Draw == Probe("8/4k3/8/4K3/4P3/8/8/8 w - - 0 1"));
+    CHECK(Result::Loss == Probe("8/4k3/8/4K3/4P3/8/8/8 b - - 0 1"));
+    CHECK(Result::Win == Probe("4k3/8/4K3/4P3/8/8/8/8 w - - 0 1"));
+
+    // Black's pawn, stalemating white
+    CHECK(Result::Draw == Probe("8/8/8/8/8/4k3/4p3/4K3 w - - 0 1"));
+    CHECK(Result::Win == Probe("8/8/8/8/8/4k3/4p3/4K3 b - - 0 1"));
+
+    // A rook pawn with the defending king in the corner
+    CHECK(Result::Draw == Probe("k7/8/8/8/8/8/P7/1K6 w - - 0 1"));
+
+    // Not the bitbases' material
+    CHECK(Result::Unknown == Probe("k7/8/1K6/8/8/8/8/1B6 w - - 0 1"));
+    CHECK(Result::Unknown == Probe("k7/8/1K6/8/8/8/P7/1R6 w - - 0 1"));
+}
+
+TEST_GROUP(Bitbase_Search_Tests)
+{
+    const char* directory = "bitbase_search_tests";
+
+    void teardown() {
+        Bitbase::Unload();
+        for (Endgame endgame : { Endgame::Kpk, Endgame::Krk, Endgame::Kqk })
+            remove((std::string(directory) + "/" + Bitbase::FileName(endgame)).c_str());
+        rmdir(directory);
+    }
+
+    // Each search gets its own engine, so that nothing carries over in the hash table
+    SearchResult SearchToDepth(BoardState& bs, unsigned depth) {
+        ChessEngine engine;
+        engine.SetHashSize(1);
+        SearchLimits limits;
+        limits.depth = depth;
+        engine.SetSearchLimits(limits);
+        return engine.RunSearch(bs);
+    }
+};
+
+TEST(Bitbase_Search_Tests, Search)
+{
+    // A drawn KPK position, that the evaluation has white a pawn up
+    BoardState bs("8/4k3/8/4K3/4P3/8/8/8 w - - 0 1");
+    CHECK(SearchToDepth(bs, 4).score > 0);
+
+    mkdir(directory, 0755);
+    CHECK(Bitbase::Save(Generated().kpk, (std::string(directory) + "/kpk.bin").c_str()));
+    CHECK_EQUAL(1, Bitbase::Load(directory));
+    CHECK_EQUAL(0, SearchToDepth(bs, 4).score);
+
+    // With black to move it's won, and scores above any material advantage
+    BoardState black("8/4k3/8/4K3/4P3/8/8/8 b - - 0 1");
+    CHECK(SearchToDepth(black, 4).score < -1000);
+}
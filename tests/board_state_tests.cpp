@@ -0,0 +1,409 @@
+#include <cstring>
+#include <stdexcept>
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/SimpleString.h"
+
+// So we can check the value of private members
+#define private public
+#include "board_state.h"
+#undef private
+
+#include "chess_engine.h"
+
+#include "test_utils.h"
+
+TEST_GROUP(BoardState_Tests)
+{
+    using Idx = TileName;
+
+    void setup() {}
+    void teardown() {}
+
+    void CheckTile(TileIndex index, Color color, PieceType type, const BoardState& bs) {
+        TileContents tc = bs.GetTile(index);
+        CHECK(tc.piece_type == type);
+        if (type != PieceType::None)
+            CHECK(tc.color == color);
+    }
+};
+
+TEST(BoardState_Tests, FenInitialPosition)
+{
+    BoardState expected;
+    BoardState bs("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+
+    for (int color = 0; color < 2; color++) {
+        CHECK_EQUAL(expected.bitboards[color].pawns, bs.bitboards[color].pawns);
+        CHECK_EQUAL(expected.bitboards[color].knights, bs.bitboards[color].knights);
+        CHECK_EQUAL(expected.bitboards[color].bishops, bs.bitboards[color].bishops);
+        CHECK_EQUAL(expected.bitboards[color].rooks, bs.bitboards[color].rooks);
+        CHECK_EQUAL(expected.bitboards[color].queens, bs.bitboards[color].queens);
+        CHECK_EQUAL(expected.bitboards[color].king, bs.bitboards[color].king);
+        CHECK_EQUAL(0, bs.castling[color].rook_a_has_moved);
+        CHECK_EQUAL(0, bs.castling[color].rook_h_has_moved);
+        CHECK_EQUAL(0, bs.castling[color].king_has_moved);
+    }
+
+    CHECK(bs.GetPlayerToMove() == Color::White);
+    CHECK(expected.MailboxIsConsistent());
+    CHECK(bs.MailboxIsConsistent());
+    CHECK_EQUAL(0, bs.ply_counter);
+    CHECK_EQUAL(0, bs.half_move_counter);
+    CHECK_EQUAL(Bitboard(0), bs.en_passant_target_bitboard);
+}
+
+TEST(BoardState_Tests, FenFields)
+{
+    BoardState bs("r3k2r/8/8/3pP3/8/8/8/4K2R w Kq d6 3 20");
+
+    CheckTile(Idx::A8, Color::Black, PieceType::Rook, bs);
+    CheckTile(Idx::E8, Color::Black, PieceType::King, bs);
+    CheckTile(Idx::H8, Color::Black, PieceType::Rook, bs);
+    CheckTile(Idx::D5, Color::Black, PieceType::Pawn, bs);
+    CheckTile(Idx::E5, Color::White, PieceType::Pawn, bs);
+    CheckTile(Idx::E1, Color::White, PieceType::King, bs);
+    CheckTile(Idx::H1, Color::White, PieceType::Rook, bs);
+    CheckTile(Idx::A1, Color::None, PieceType::None, bs);
+
+    CHECK(bs.GetPlayerToMove() == Color::White);
+    CHECK_EQUAL(38, bs.ply_counter);
+    CHECK_EQUAL(3, bs.half_move_counter);
+    CHECK_EQUAL(Bitboard(Idx::D6), bs.en_passant_target_bitboard);
+
+    const CastlingRights& white = bs.castling[static_cast<int>(Color::White)];
+    const CastlingRights& black = bs.castling[static_cast<int>(Color::Black)];
+    CHECK_EQUAL(0, white.rook_h_has_moved);
+    CHECK_EQUAL(1, white.rook_a_has_moved);
+    CHECK_EQUAL(1, black.rook_h_has_moved);
+    CHECK_EQUAL(0, black.rook_a_has_moved);
+
+    BoardState black_to_move("4k3/8/8/8/8/8/8/4K3 b - - 0 1");
+    CHECK(black_to_move.GetPlayerToMove() == Color::Black);
+    CHECK_EQUAL(1, black_to_move.ply_counter);
+}
+
+TEST(BoardState_Tests, FenInvalid)
+{
+    CHECK_THROWS(std::invalid_argument, BoardState("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1"));
+    CHECK_THROWS(std::invalid_argument, BoardState("rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"));
+    CHECK_THROWS(std::invalid_argument, BoardState("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNX w KQkq - 0 1"));
+    CHECK_THROWS(std::invalid_argument, BoardState("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1"));
+    CHECK_THROWS(std::invalid_argument, BoardState("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkx - 0 1"));
+    CHECK_THROWS(std::invalid_argument, BoardState("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e4 0 1"));
+
+    // Castling rights without the king and rook on their home tiles
+    CHECK_THROWS(std::invalid_argument, BoardState("8/8/8/8/8/8/8/R2K3R w KQ - 0 1"));
+    CHECK_THROWS(std::invalid_argument, BoardState("4k3/8/8/8/8/8/8/4K2R w Q - 0 1"));
+    CHECK_THROWS(std::invalid_argument, BoardState("r3k3/8/8/8/8/8/8/4K3 w k - 0 1"));
+    BoardState castling("r3k3/8/8/8/8/8/8/4K2R w Kq - 0 1");
+    CHECK(castling.GetCastlingRights(Color::White).rook_a_has_moved);
+    CHECK_FALSE(castling.GetCastlingRights(Color::White).rook_h_has_moved);
+
+    // En passant targets on the wrong rank for the player to move, or with no pawn that just
+    // double pushed in front of them
+    CHECK_THROWS(std::invalid_argument, BoardState("4k3/8/8/8/4P3/8/8/4K3 w - e3 0 1"));
+    CHECK_THROWS(std::invalid_argument, BoardState("4k3/8/8/3pP3/8/8/8/4K3 b - d6 0 1"));
+    CHECK_THROWS(std::invalid_argument, BoardState("4k3/8/8/4P3/8/8/8/4K3 w - d6 0 1"));
+    CHECK_THROWS(std::invalid_argument, BoardState("4k3/8/3n4/3pP3/8/8/8/4K3 w - d6 0 1"));
+    BoardState en_passant("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1");
+    CHECK_EQUAL(Bitboard(TileIndex(TileName::D6)), en_passant.GetEnPassantTarget());
+}
+
+TEST(BoardState_Tests, FenOptionalFields)
+{
+    // EPD operations follow the en passant field instead of the move counters
+    BoardState epd("4k3/8/8/8/8/8/8/4K3 b - - bm Kd7; id \"test\";");
+    CHECK(epd.GetPlayerToMove() == Color::Black);
+    CHECK_EQUAL(1, epd.ply_counter);
+    CHECK_EQUAL(0, epd.half_move_counter);
+
+    // Any whitespace separates the fields, as in lines read from a file
+    BoardState spaced("  4k3/8/8/8/8/8/8/4K3\tw  -  -  7 30\r\n");
+    CHECK_EQUAL(58, spaced.ply_counter);
+    CHECK_EQUAL(7, spaced.half_move_counter);
+
+    CHECK_THROWS(std::invalid_argument, BoardState("4k3/8/8/8/8/8/8/4K3 w -"));
+    CHECK_THROWS(std::invalid_argument, BoardState("4k3/8/8/8/8/8/8/4K3 w - - 0 0"));
+}
+
+TEST(BoardState_Tests, FenRoundTrip)
+{
+    const char* const fens[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/8/8/3pP3/8/8/8/4K2R w Kq d6 3 20",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 b - - 49 123",
+        "4k3/8/8/8/3pP3/8/8/4K3 b - e3 0 1",
+    };
+
+    char buffer[BoardState::max_fen_length + 1];
+    for (const char* fen : fens) {
+        BoardState bs(fen);
+        STRCMP_EQUAL(fen, bs.GetFen().c_str());
+        CHECK_EQUAL(strlen(fen), bs.WriteFen(buffer));
+        STRCMP_EQUAL(fen, buffer);
+    }
+
+    // Moves update every field
+    BoardState bs("r3k2r/8/8/8/8/8/4P3/R3K2R w KQkq - 5 10");
+    bs.ApplyMove(Move(TileIndex(Idx::E2), TileIndex(Idx::E4), Move::DoublePawnPush));
+    STRCMP_EQUAL("r3k2r/8/8/8/4P3/8/8/R3K2R b KQkq e3 0 10", bs.GetFen().c_str());
+    bs.ApplyMove(Move(TileIndex(Idx::H8), TileIndex(Idx::H1), Move::Capture));
+    STRCMP_EQUAL("r3k3/8/8/8/4P3/8/8/R3K2r w Qq - 0 11", bs.GetFen().c_str());
+}
+
+TEST(BoardState_Tests, MovePacking)
+{
+    Move move(static_cast<unsigned>(Idx::B7), static_cast<unsigned>(Idx::A8), Move::PromotionCapture | 3);
+
+    CHECK_EQUAL(2, sizeof(Move));
+    CHECK_EQUAL(static_cast<unsigned>(Idx::B7), move.GetSrcTileIndex());
+    CHECK_EQUAL(static_cast<unsigned>(Idx::A8), move.GetDestTileIndex());
+    CHECK(move.IsCapture());
+    CHECK(move.IsPromotion());
+    CHECK(move.GetPromotionType() == PieceType::Queen);
+    CHECK_FALSE(move.IsEnPassant());
+    CHECK_FALSE(move.IsCastle());
+
+    CHECK(Move(0, 0, Move::EnPassant).IsCapture());
+    CHECK_FALSE(Move(0, 0, Move::KingCastle).IsCapture());
+    CHECK(Move(0, 0, Move::QueenCastle).IsCastle());
+}
+
+TEST(BoardState_Tests, ApplyMoveCastling)
+{
+    BoardState bs("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 5 1");
+    UndoRecord undo;
+
+    bs.ApplyMove(Move(static_cast<unsigned>(Idx::E1), static_cast<unsigned>(Idx::G1), Move::KingCastle), undo);
+    CheckTile(Idx::G1, Color::White, PieceType::King, bs);
+    CheckTile(Idx::F1, Color::White, PieceType::Rook, bs);
+    CheckTile(Idx::H1, Color::None, PieceType::None, bs);
+    CHECK_EQUAL(1, bs.GetCastlingRights(Color::White).king_has_moved);
+    CHECK_EQUAL(0, bs.GetCastlingRights(Color::Black).king_has_moved);
+    CHECK_EQUAL(0, undo.prev_castling_rights[static_cast<int>(Color::White)].king_has_moved);
+    CHECK_EQUAL(5, undo.prev_half_move_counter);
+    CHECK_EQUAL(6, bs.half_move_counter);
+
+    bs.ApplyMove(Move(static_cast<unsigned>(Idx::E8), static_cast<unsigned>(Idx::C8), Move::QueenCastle));
+    CheckTile(Idx::C8, Color::Black, PieceType::King, bs);
+    CheckTile(Idx::D8, Color::Black, PieceType::Rook, bs);
+    CheckTile(Idx::A8, Color::None, PieceType::None, bs);
+    CHECK_EQUAL(1, bs.GetCastlingRights(Color::Black).king_has_moved);
+}
+
+TEST(BoardState_Tests, ApplyMoveCapturingRookLosesCastlingRights)
+{
+    BoardState bs("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+    UndoRecord undo;
+
+    bs.ApplyMove(Move(static_cast<unsigned>(Idx::H1), static_cast<unsigned>(Idx::H8), Move::Capture), undo);
+    CHECK(undo.captured_type == PieceType::Rook);
+    CHECK_EQUAL(1, bs.GetCastlingRights(Color::White).rook_h_has_moved);
+    CHECK_EQUAL(1, bs.GetCastlingRights(Color::Black).rook_h_has_moved);
+    CHECK_EQUAL(0, bs.GetCastlingRights(Color::Black).rook_a_has_moved);
+    CHECK_EQUAL(0, bs.half_move_counter);
+}
+
+TEST(BoardState_Tests, ApplyMoveEnPassant)
+{
+    BoardState bs("4k3/8/8/8/5p2/8/4P3/4K3 w - - 0 1");
+    UndoRecord undo;
+
+    bs.ApplyMove(Move(static_cast<unsigned>(Idx::E2), static_cast<unsigned>(Idx::E4), Move::DoublePawnPush));
+    CHECK_EQUAL(Bitboard(Idx::E3), bs.GetEnPassantTarget());
+
+    bs.ApplyMove(Move(static_cast<unsigned>(Idx::F4), static_cast<unsigned>(Idx::E3), Move::EnPassant), undo);
+    CheckTile(Idx::E3, Color::Black, PieceType::Pawn, bs);
+    CheckTile(Idx::E4, Color::None, PieceType::None, bs);
+    CHECK(undo.captured_type == PieceType::Pawn);
+    CHECK_EQUAL(Bitboard(Idx::E3), undo.prev_en_passant_target);
+    CHECK_EQUAL(Bitboard(0), bs.GetEnPassantTarget());
+}
+
+TEST(BoardState_Tests, ApplyMovePromotion)
+{
+    BoardState bs("1n2k3/P7/8/8/8/8/8/4K3 w - - 0 1");
+    UndoRecord undo;
+
+    bs.ApplyMove(Move(static_cast<unsigned>(Idx::A7), static_cast<unsigned>(Idx::B8), Move::PromotionCapture | 0), undo);
+    CheckTile(Idx::B8, Color::White, PieceType::Knight, bs);
+    CheckTile(Idx::A7, Color::None, PieceType::None, bs);
+    CHECK_EQUAL(Bitboard(0), bs.bitboards[static_cast<int>(Color::White)].pawns);
+    CHECK(undo.captured_type == PieceType::Knight);
+}
+
+TEST_GROUP(BoardState_UndoTests)
+{
+    ChessEngine engine;
+
+    void CheckEqual(const BoardState& expected, const BoardState& actual) {
+        for (int color = 0; color < 2; color++) {
+            CHECK_EQUAL(expected.bitboards[color].pawns, actual.bitboards[color].pawns);
+            CHECK_EQUAL(expected.bitboards[color].knights, actual.bitboards[color].knights);
+            CHECK_EQUAL(expected.bitboards[color].bishops, actual.bitboards[color].bishops);
+            CHECK_EQUAL(expected.bitboards[color].rooks, actual.bitboards[color].rooks);
+            CHECK_EQUAL(expected.bitboards[color].queens, actual.bitboards[color].queens);
+            CHECK_EQUAL(expected.bitboards[color].king, actual.bitboards[color].king);
+            CHECK_EQUAL(expected.castling[color].rook_a_has_moved, actual.castling[color].rook_a_has_moved);
+            CHECK_EQUAL(expected.castling[color].rook_h_has_moved, actual.castling[color].rook_h_has_moved);
+            CHECK_EQUAL(expected.castling[color].king_has_moved, actual.castling[color].king_has_moved);
+        }
+        CHECK_EQUAL(expected.en_passant_target_bitboard, actual.en_passant_target_bitboard);
+        CHECK_EQUAL(expected.ply_counter, actual.ply_counter);
+        CHECK_EQUAL(expected.half_move_counter, actual.half_move_counter);
+        CHECK_EQUAL(expected.hash_key, actual.hash_key);
+        CHECK_EQUAL(expected.pawn_hash_key, actual.pawn_hash_key);
+        CHECK_EQUAL(expected.psqt_score.mg, actual.psqt_score.mg);
+        CHECK_EQUAL(expected.psqt_score.eg, actual.psqt_score.eg);
+        CHECK_EQUAL(expected.game_phase, actual.game_phase);
+        for (unsigned i = 0; i < TileIndex::num_tiles; i++)
+            CHECK_EQUAL(expected.piece_on[i], actual.piece_on[i]);
+    }
+
+    // Applies and undoes every move in the tree, checking that each undo restores the board
+    void CheckUndo(BoardState& bs, unsigned depth) {
+        MoveList moves;
+        engine.GenerateMoves(bs, moves);
+
+        for (Move move : moves) {
+            BoardState before = bs;
+            UndoRecord undo;
+            bs.ApplyMove(move, undo);
+            CHECK(bs.HashKeysAreConsistent());
+            CHECK(bs.EvaluationIsConsistent());
+            CHECK(bs.MailboxIsConsistent());
+            if (depth > 1)
+                CheckUndo(bs, depth - 1);
+            bs.UndoMove(move, undo);
+            CheckEqual(before, bs);
+        }
+    }
+};
+
+TEST(BoardState_UndoTests, UndoRestoresBoard)
+{
+    // Between them, these cover castling, en passant, promotions and captures of rooks
+    BoardState kiwipete("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    BoardState position4("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1");
+    BoardState position5("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8");
+
+    CheckUndo(kiwipete, 2);
+    CheckUndo(position4, 2);
+    CheckUndo(position5, 2);
+}
+
+TEST_GROUP(BoardState_HashTests)
+{
+    using Idx = TileName;
+};
+
+TEST(BoardState_HashTests, FenMatchesInitialPosition)
+{
+    BoardState expected;
+    BoardState bs("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+
+    CHECK(expected.HashKeysAreConsistent());
+    CHECK(bs.HashKeysAreConsistent());
+    CHECK_EQUAL(expected.GetHashKey(), bs.GetHashKey());
+    CHECK_EQUAL(expected.GetPawnHashKey(), bs.GetPawnHashKey());
+}
+
+TEST(BoardState_HashTests, StateIsHashed)
+{
+    BoardState bs("r3k2r/8/8/3pP3/8/8/8/R3K2R w KQkq d6 0 1");
+    BoardState black_to_move("r3k2r/8/8/3pP3/8/8/8/R3K2R b KQkq - 0 1");
+    BoardState no_castling("r3k2r/8/8/3pP3/8/8/8/R3K2R w Kkq d6 0 1");
+    BoardState no_en_passant("r3k2r/8/8/3pP3/8/8/8/R3K2R w KQkq - 0 1");
+
+    CHECK(bs.GetHashKey() != black_to_move.GetHashKey());
+    CHECK(bs.GetHashKey() != no_castling.GetHashKey());
+    CHECK(bs.GetHashKey() != no_en_passant.GetHashKey());
+
+    // None of these change the pawns
+    CHECK_EQUAL(bs.GetPawnHashKey(), black_to_move.GetPawnHashKey());
+    CHECK_EQUAL(bs.GetPawnHashKey(), no_castling.GetPawnHashKey());
+    CHECK_EQUAL(bs.GetPawnHashKey(), no_en_passant.GetPawnHashKey());
+}
+
+TEST(BoardState_HashTests, Transposition)
+{
+    // 1. Nf3 Nf6 2. Nc3 Nc6 and 1. Nc3 Nc6 2. Nf3 Nf6 reach the same position
+    BoardState a;
+    BoardState b;
+    a.ApplyMove(Move(TileIndex(Idx::G1), TileIndex(Idx::F3)));
+    a.ApplyMove(Move(TileIndex(Idx::G8), TileIndex(Idx::F6)));
+    a.ApplyMove(Move(TileIndex(Idx::B1), TileIndex(Idx::C3)));
+    a.ApplyMove(Move(TileIndex(Idx::B8), TileIndex(Idx::C6)));
+    b.ApplyMove(Move(TileIndex(Idx::B1), TileIndex(Idx::C3)));
+    b.ApplyMove(Move(TileIndex(Idx::B8), TileIndex(Idx::C6)));
+    b.ApplyMove(Move(TileIndex(Idx::G1), TileIndex(Idx::F3)));
+    b.ApplyMove(Move(TileIndex(Idx::G8), TileIndex(Idx::F6)));
+
+    CHECK_EQUAL(a.GetHashKey(), b.GetHashKey());
+    CHECK_EQUAL(BoardState().GetPawnHashKey(), a.GetPawnHashKey());
+
+    // Moving the knights back gives the initial position, apart from the move counters
+    a.ApplyMove(Move(TileIndex(Idx::F3), TileIndex(Idx::G1)));
+    a.ApplyMove(Move(TileIndex(Idx::F6), TileIndex(Idx::G8)));
+    a.ApplyMove(Move(TileIndex(Idx::C3), TileIndex(Idx::B1)));
+    a.ApplyMove(Move(TileIndex(Idx::C6), TileIndex(Idx::B8)));
+    CHECK_EQUAL(BoardState().GetHashKey(), a.GetHashKey());
+
+    // A double pawn push sets an en passant target. No black pawn can capture on e3, so it isn't
+    // hashed, and the position is the same as with no target.
+    BoardState e4;
+    e4.ApplyMove(Move(TileIndex(Idx::E2), TileIndex(Idx::E4), Move::DoublePawnPush));
+    BoardState e4_fen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+    BoardState e4_no_target("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1");
+    CHECK(e4.HashKeysAreConsistent());
+    CHECK_EQUAL(e4_fen.GetHashKey(), e4.GetHashKey());
+    CHECK_EQUAL(e4_no_target.GetHashKey(), e4.GetHashKey());
+    CHECK_EQUAL(e4_fen.GetPawnHashKey(), e4.GetPawnHashKey());
+
+    // With a black pawn on d4 it can, so the target is hashed, until the next move clears it
+    BoardState d4("rnbqkbnr/ppp1pppp/8/8/3p4/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    UndoRecord undo;
+    uint64_t before = d4.GetHashKey();
+    d4.ApplyMove(Move(TileIndex(Idx::E2), TileIndex(Idx::E4), Move::DoublePawnPush), undo);
+    CHECK(d4.HashKeysAreConsistent());
+    CHECK_EQUAL(BoardState("rnbqkbnr/ppp1pppp/8/8/3pP3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1").GetHashKey(), d4.GetHashKey());
+    CHECK(BoardState("rnbqkbnr/ppp1pppp/8/8/3pP3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1").GetHashKey() != d4.GetHashKey());
+    d4.UndoMove(Move(TileIndex(Idx::E2), TileIndex(Idx::E4), Move::DoublePawnPush), undo);
+    CHECK_EQUAL(before, d4.GetHashKey());
+}
+
+TEST_GROUP(BoardState_EvaluationTests)
+{
+};
+
+TEST(BoardState_EvaluationTests, Symmetric)
+{
+    BoardState initial;
+    CHECK(initial.EvaluationIsConsistent());
+    CHECK_EQUAL(0, initial.GetEvaluation());
+    CHECK_EQUAL(Evaluation::max_phase, initial.game_phase);
+
+    // The same position with the colors swapped (and the board flipped) scores the opposite
+    BoardState white("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    BoardState black("r3k2r/pppbbppp/2n2q1P/1P2p3/3pn3/BN2PNP1/P1PPQPB1/R3K2R b KQkq - 0 1");
+    CHECK(white.GetEvaluation() != 0);
+    CHECK_EQUAL(white.GetEvaluation(), -black.GetEvaluation());
+}
+
+TEST(BoardState_EvaluationTests, Terms)
+{
+    // Kings on their middlegame tiles, and a pawn. With no pieces, the endgame scores apply.
+    BoardState bs("6k1/8/8/8/8/8/4P3/6K1 w - - 0 1");
+    CHECK_EQUAL(0, bs.game_phase);
+    CHECK_EQUAL(100 + (-30) - (-30), bs.GetEvaluation());
+
+    // A knight adds its weight to the phase, and its value and tile score to the evaluation
+    bs.SetTile(TileIndex(TileName::D4), TileContents(Color::Black, PieceType::Knight));
+    CHECK(bs.EvaluationIsConsistent());
+    CHECK_EQUAL(1, bs.game_phase);
+
+    // Pawn on e2 (-20 in the middlegame), knight on d4 (+20 from black's side); the kings cancel
+    Evaluation::Score expected = { (100 - 20) - (300 + 20), 100 - (300 + 20) };
+    CHECK_EQUAL((expected.mg * 1 + expected.eg * 23) / 24, bs.GetEvaluation());
+}
@@ -74,4 +74,184 @@ TEST(ChessEngine_Tests, GetRayAttacks)
         CHECK_EQUAL(pair.second & ~(edge_blockers | one_from_edge_blockers),
             engine.GetRayAttacks(d4, pair.first));
     }
-}
\ No newline at end of file
+}
+TEST(ChessEngine_Tests, PerftInitialPosition)
+{
+    CHECK_EQUAL(1, engine.Perft(bs, 0));
+    CHECK_EQUAL(20, engine.Perft(bs, 1));
+    CHECK_EQUAL(400, engine.Perft(bs, 2));
+    CHECK_EQUAL(8902, engine.Perft(bs, 3));
+}
+
+TEST(ChessEngine_Tests, SpecialMoves)
+{
+    // Castling both ways, en passant, and promotions (with and without capture)
+    BoardState special("r3k2r/1P6/8/3pP3/8/8/8/R3K2R w KQkq d6 0 1");
+    MoveList moves;
+    engine.GenerateMoves(special, moves);
+
+    unsigned castles = 0, en_passant = 0, promotions = 0;
+    for (Move m : moves) {
+        castles += m.IsCastle();
+        en_passant += m.IsEnPassant();
+        promotions += m.IsPromotion();
+    }
+    CHECK_EQUAL(2, castles);
+    CHECK_EQUAL(1, en_passant);
+    CHECK_EQUAL(8, promotions);
+
+    Move player_move(static_cast<unsigned>(Idx::B7), static_cast<unsigned>(Idx::A8));
+    CHECK(engine.IsLegalMove(special, player_move));
+    CHECK(player_move.IsCapture());
+    CHECK(player_move.GetPromotionType() == PieceType::Queen);
+}
+
+TEST(ChessEngine_Tests, PerftReferencePositions)
+{
+    // From https://www.chessprogramming.org/Perft_Results. Both generators must agree.
+    BoardState kiwipete("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    CHECK_EQUAL(48, engine.Perft(kiwipete, 1));
+    CHECK_EQUAL(2039, engine.Perft(kiwipete, 2));
+    CHECK_EQUAL(97862, engine.Perft(kiwipete, 3));
+    CHECK_EQUAL(2039, engine.PerftPseudoLegal(kiwipete, 2));
+
+    BoardState position_3("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1");
+    CHECK_EQUAL(2812, engine.Perft(position_3, 3));
+    CHECK_EQUAL(43238, engine.Perft(position_3, 4));
+    CHECK_EQUAL(2812, engine.PerftPseudoLegal(position_3, 3));
+
+    BoardState position_4("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1");
+    CHECK_EQUAL(6, engine.Perft(position_4, 1));
+    CHECK_EQUAL(9467, engine.Perft(position_4, 3));
+}
+
+TEST(ChessEngine_Tests, LegalMoves)
+{
+    MoveList moves;
+    auto count_from = [&moves](TileIndex src) {
+        unsigned count = 0;
+        for (Move m : moves)
+            count += (m.GetSrcTileIndex() == src);
+        return count;
+    };
+
+    // The bishop is pinned off its diagonals, and the rook can only move along its pin ray
+    BoardState pinned("4k3/4r3/8/8/1b6/8/3NB3/4K3 w - - 0 1");
+    engine.GenerateMoves(pinned, moves);
+    CHECK_EQUAL(0, count_from(Idx::E2));
+    CHECK_EQUAL(0, count_from(Idx::D2));
+    CHECK(engine.pinned_ == (Bitboard(Idx::D2) | Bitboard(Idx::E2)));
+    BoardState pinned_rook("4k3/4r3/8/8/8/8/4R3/4K3 w - - 0 1");
+    engine.GenerateMoves(pinned_rook, moves);
+    CHECK_EQUAL(5, count_from(Idx::E2));
+
+    // In check from the rook: block, capture or step aside, but not back along the rank
+    BoardState check("4k3/8/8/8/8/8/1B6/r3K3 w - - 0 1");
+    engine.GenerateMoves(check, moves);
+    CHECK(engine.GetCheckers() == Bitboard(Idx::A1));
+    CHECK_EQUAL(2, count_from(Idx::B2));      // Ba1 and Bc1
+    CHECK_EQUAL(3, count_from(Idx::E1));      // d2, e2 and f2
+    CHECK_EQUAL(5, moves.Size());
+
+    // Double check: only the king moves
+    BoardState double_check("4k3/8/8/8/8/5n2/1B6/r3K3 w - - 0 1");
+    engine.GenerateMoves(double_check, moves);
+    CHECK_EQUAL(moves.Size(), count_from(Idx::E1));
+
+    // Capturing en passant would remove both pawns from between the king and the rook
+    BoardState en_passant("8/8/8/K2pP2r/8/8/8/7k w - d6 0 1");
+    engine.GenerateMoves(en_passant, moves);
+    for (Move m : moves)
+        CHECK(!m.IsEnPassant());
+
+    // En passant captures the checking pawn
+    BoardState en_passant_evasion("8/8/8/3pP3/4K3/8/8/7k w - d6 0 1");
+    Move capture(static_cast<unsigned>(Idx::E5), static_cast<unsigned>(Idx::D6));
+    CHECK(engine.IsLegalMove(en_passant_evasion, capture));
+    CHECK(capture.IsEnPassant());
+
+    // No castling through an attacked tile. The queen side rook may pass over one.
+    BoardState castling("1r2k3/8/8/8/8/8/8/R3K2R w KQ - 0 1");
+    BoardState through_check("4k3/8/8/8/8/8/5r2/R3K2R w KQ - 0 1");
+    BoardState in_check("4k3/8/8/8/8/4r3/8/R3K2R w KQ - 0 1");
+    unsigned castles = 0;
+    engine.GenerateMoves(castling, moves);
+    for (Move m : moves)
+        castles += m.IsCastle();
+    CHECK_EQUAL(2, castles);
+    engine.GenerateMoves(through_check, moves);
+    for (Move m : moves)
+        CHECK(!m.IsCastle() || m.GetDestTileIndex() == static_cast<unsigned>(Idx::C1));
+    engine.GenerateMoves(in_check, moves);
+    for (Move m : moves)
+        CHECK(!m.IsCastle());
+}
+
+TEST(ChessEngine_Tests, AttackersTo)
+{
+    // e4 is attacked by the white knight and pawn, and the black bishop and rook. The white
+    // queen is behind the pawn, and the black queen behind the rook.
+    BoardState position("7k/1b2q3/8/4r3/8/3P4/2Q2N2/6K1 w - - 0 1");
+    Bitboard occupied = position.GetBitboards(Color::White).GetBitboardsUnion()
+        | position.GetBitboards(Color::Black).GetBitboardsUnion();
+
+    Bitboard attackers = Bitboard(Idx::F2) | Bitboard(Idx::D3) | Bitboard(Idx::B7) | Bitboard(Idx::E5);
+    CHECK_EQUAL(attackers, engine.AttackersTo(position, Idx::E4, occupied));
+
+    // Taking a piece off the board uncovers the slider behind it
+    CHECK_EQUAL(attackers | Bitboard(Idx::C2), engine.AttackersTo(position, Idx::E4, occupied ^ Bitboard(Idx::D3)));
+    CHECK_EQUAL(attackers | Bitboard(Idx::E7), engine.AttackersTo(position, Idx::E4, occupied ^ Bitboard(Idx::E5)));
+
+    CHECK(engine.IsSquareAttacked(position, Idx::E4, Color::White));
+    CHECK(engine.IsSquareAttacked(position, Idx::E4, Color::Black));
+    CHECK(engine.IsSquareAttacked(position, Idx::E2, Color::White));
+    CHECK(engine.IsSquareAttacked(position, Idx::F6, Color::Black));
+    CHECK(!engine.IsSquareAttacked(position, Idx::H8, Color::White));
+    CHECK(!engine.IsSquareAttacked(position, Idx::A1, Color::Black));
+}
+
+TEST(ChessEngine_Tests, IsOwnKingInCheck)
+{
+    CHECK(!engine.IsOwnKingInCheck(bs));
+
+    BoardState pawn_check("4k3/8/8/8/8/8/3p4/4K3 w - - 0 1");
+    CHECK(engine.IsOwnKingInCheck(pawn_check));
+    BoardState blocked("4k3/4r3/8/8/8/8/4B3/4K3 w - - 0 1");
+    CHECK(!engine.IsOwnKingInCheck(blocked));
+    BoardState black_in_check("4k3/8/8/b7/8/8/8/4R1K1 b - - 0 1");
+    CHECK(engine.IsOwnKingInCheck(black_in_check));
+}
+
+TEST(ChessEngine_Tests, CaptureAndQuietGeneration)
+{
+    // Captures and quiet moves are the legal moves, split in two. The king can't capture the
+    // knight, on the rank it is checked along.
+    const char* fens[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/8/8/3pP3/4K3/8/8/7k w - d6 0 1",
+        "7k/8/8/8/8/8/r3Kn2/8 w - - 0 1",
+    };
+    for (const char* fen : fens) {
+        BoardState position(fen);
+        MoveList all, captures, quiets;
+        engine.GenerateMoves(position, all);
+        engine.GenerateMoves(position, captures, ChessEngine::GenType::Captures);
+        engine.GenerateMoves(position, quiets, ChessEngine::GenType::Quiets);
+        CHECK_EQUAL(all.Size(), captures.Size() + quiets.Size());
+
+        for (Move m : captures) {
+            CHECK(m.IsCapture());
+            bool found = false;
+            for (Move a : all)
+                found |= (a == m);
+            CHECK(found);
+        }
+        for (Move m : quiets)
+            CHECK(!m.IsCapture());
+    }
+
+    BoardState king_captures("7k/8/8/8/8/8/r3Kn2/8 w - - 0 1");
+    MoveList captures;
+    engine.GenerateMoves(king_captures, captures, ChessEngine::GenType::Captures);
+    CHECK_EQUAL(0, captures.Size());
+}
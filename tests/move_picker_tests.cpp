@@ -0,0 +1,107 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/SimpleString.h"
+
+// So we can check the value of private members
+#define private public
+#include "chess_engine.h"
+#undef private
+
+#include "move_picker.h"
+#include "board_state.h"
+
+
+TEST_GROUP(MovePicker_Tests)
+{
+    using Idx = TileName;
+
+    ChessEngine engine;
+
+    Move MakeMove(Idx src, Idx dest, unsigned flags = Move::Quiet) {
+        return Move(static_cast<unsigned>(src), static_cast<unsigned>(dest), flags);
+    }
+};
+
+TEST(MovePicker_Tests, ReturnsEveryMoveOnce)
+{
+    BoardState bs("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    MoveList all;
+    engine.GenerateMoves(bs, all);
+
+    Move hash_move = MakeMove(Idx::E1, Idx::G1, Move::KingCastle);
+    MovePicker picker(engine, bs, hash_move);
+    CHECK(picker.Next() == hash_move);
+
+    unsigned count = 1;
+    for (Move move = picker.Next(); !move.IsNull(); move = picker.Next()) {
+        count++;
+        CHECK(move != hash_move);
+        bool found = false;
+        for (Move m : all)
+            found |= (m == move);
+        CHECK(found);
+    }
+    CHECK_EQUAL(all.Size(), count);
+    CHECK(!picker.InCheck());
+}
+
+TEST(MovePicker_Tests, CapturesByMvvLva)
+{
+    // The pawn and the knight can both take the queen, and the rook can take a pawn
+    BoardState bs("4k3/8/8/3q4/2P1p2R/4N3/8/6K1 w - - 0 1");
+    MovePicker picker(engine, bs, Move());
+
+    CHECK(picker.Next() == MakeMove(Idx::C4, Idx::D5, Move::Capture));
+    CHECK(picker.Next() == MakeMove(Idx::E3, Idx::D5, Move::Capture));
+    CHECK(picker.Next() == MakeMove(Idx::H4, Idx::E4, Move::Capture));
+
+    // Quiet moves haven't been generated yet
+    CHECK(engine.gen_type_ == ChessEngine::GenType::Captures);
+    CHECK(!picker.Next().IsCapture());
+    CHECK(engine.gen_type_ == ChessEngine::GenType::Quiets);
+}
+
+TEST(MovePicker_Tests, HashMoveMustBeGenerated)
+{
+    // Hash moves from other positions (a key collision), which must never be played here: from
+    // an empty tile, a knight moving like a rook, a rook through a pawn, and a castle with the
+    // path clear but no rights
+    BoardState bs("4k3/8/8/8/8/8/P7/RN2K2R w - - 0 1");
+    Move bogus[] = {
+        MakeMove(Idx::A3, Idx::A4),
+        MakeMove(Idx::B1, Idx::B3),
+        MakeMove(Idx::A1, Idx::A3),
+        MakeMove(Idx::E1, Idx::G1, Move::KingCastle),
+    };
+    MoveList all;
+    engine.GenerateMoves(bs, all);
+
+    for (Move hash_move : bogus) {
+        MovePicker picker(engine, bs, hash_move);
+        unsigned count = 0;
+        for (Move move = picker.Next(); !move.IsNull(); move = picker.Next()) {
+            CHECK(move != hash_move);
+            count++;
+        }
+        CHECK_EQUAL(all.Size(), count);
+    }
+
+    // A capture hash move which is generated is played first, and not again
+    BoardState capture("4k3/8/8/3q4/2P5/8/8/4K3 w - - 0 1");
+    MovePicker picker(engine, capture, MakeMove(Idx::C4, Idx::D5, Move::Capture));
+    CHECK(picker.Next() == MakeMove(Idx::C4, Idx::D5, Move::Capture));
+    for (Move move = picker.Next(); !move.IsNull(); move = picker.Next())
+        CHECK(!move.IsCapture());
+}
+
+TEST(MovePicker_Tests, NoMoves)
+{
+    BoardState mate("R5k1/5ppp/8/8/8/8/8/6K1 b - - 0 1");
+    MovePicker mate_picker(engine, mate, Move());
+    CHECK(mate_picker.Next().IsNull());
+    CHECK(mate_picker.InCheck());
+
+    BoardState stalemate("k7/8/1QK5/8/8/8/8/8 b - - 0 1");
+    MovePicker stalemate_picker(engine, stalemate, Move());
+    CHECK(stalemate_picker.Next().IsNull());
+    CHECK(!stalemate_picker.InCheck());
+}
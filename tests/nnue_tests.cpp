@@ -0,0 +1,141 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/SimpleString.h"
+
+#include "nnue.h"
+#include "board_state.h"
+#include "chess_engine.h"
+#include "test_utils.h"
+
+#include <cstdio>
+#include <vector>
+
+
+TEST_GROUP(Nnue_Tests)
+{
+    ChessEngine engine;
+    Nnue::Backend default_backend;
+
+    void setup() {
+        Nnue::InitRandom(1);
+        default_backend = Nnue::GetBackend();
+    }
+    void teardown() {
+        Nnue::SetBackend(default_backend);
+        Nnue::Unload();
+    }
+
+    // Plays a pseudo-random game, checking the incrementally updated evaluation against one
+    // computed from scratch after every move, and again while taking the moves back
+    void CheckIncrementalUpdates(const char* fen, int plies) {
+        BoardState bs(fen);
+        Nnue::AccumulatorStack accumulators;
+        bs.SetAccumulators(&accumulators);
+
+        std::vector<Move> game = RandomGameMoves(fen, plies);
+        std::vector<Move> played;
+        std::vector<UndoRecord> undos(game.size());
+        std::vector<int> scores;
+
+        scores.push_back(Nnue::Evaluate(bs, accumulators));
+        CHECK_EQUAL(Nnue::EvaluateFromScratch(bs), scores.back());
+        for (size_t ply = 0; ply < game.size(); ply++) {
+            played.push_back(game[ply]);
+            bs.ApplyMove(played.back(), undos[ply]);
+
+            // Skipping some evaluations updates several plies at once
+            if (ply % 3 != 1) {
+                scores.push_back(Nnue::Evaluate(bs, accumulators));
+                CHECK_EQUAL(Nnue::EvaluateFromScratch(bs), scores.back());
+            }
+        }
+
+        while (!played.empty()) {
+            bs.UndoMove(played.back(), undos[played.size() - 1]);
+            played.pop_back();
+            CHECK_EQUAL(Nnue::EvaluateFromScratch(bs), Nnue::Evaluate(bs, accumulators));
+        }
+        CHECK_EQUAL(scores[0], Nnue::Evaluate(bs, accumulators));
+        bs.SetAccumulators(nullptr);
+    }
+};
+
+TEST(Nnue_Tests, FeatureIndex)
+{
+    // Each side sees its own pieces as white ones, with the board flipped for black
+    CHECK_EQUAL(Nnue::FeatureIndex(Color::White, 4, Color::White, PieceType::Knight, 6),
+        Nnue::FeatureIndex(Color::Black, 60, Color::Black, PieceType::Knight, 62));
+    CHECK_EQUAL(Nnue::FeatureIndex(Color::White, 4, Color::Black, PieceType::Pawn, 52),
+        Nnue::FeatureIndex(Color::Black, 60, Color::White, PieceType::Pawn, 12));
+    CHECK(Nnue::FeatureIndex(Color::White, 63, Color::Black, PieceType::Queen, 63) < Nnue::num_features);
+}
+
+TEST(Nnue_Tests, IncrementalMatchesFromScratch)
+{
+    // Castling, en passant and promotions, and king moves which recompute one side
+    CheckIncrementalUpdates("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 120);
+    CheckIncrementalUpdates("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 120);
+    CheckIncrementalUpdates("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 120);
+}
+
+TEST(Nnue_Tests, BackendsAgree)
+{
+    BoardState bs("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    CHECK(Nnue::SetBackend(Nnue::Backend::Scalar));
+    int expected = Nnue::EvaluateFromScratch(bs);
+
+    for (Nnue::Backend backend : { Nnue::Backend::Sse, Nnue::Backend::Avx2 }) {
+        if (Nnue::SetBackend(backend))
+            CHECK_EQUAL(expected, Nnue::EvaluateFromScratch(bs));
+    }
+}
+
+TEST(Nnue_Tests, SaveAndLoad)
+{
+    const char* path = "nnue_tests.bin";
+    BoardState bs;
+    int expected = Nnue::EvaluateFromScratch(bs);
+    CHECK(Nnue::Save(path));
+
+    // The fields are written back to back, without the struct's padding
+    using Nnue::Network;
+    size_t expected_size = sizeof(Network::magic) + sizeof(Network::feature_biases) + sizeof(Network::feature_weights)
+        + sizeof(Network::hidden1_biases) + sizeof(Network::hidden1_weights) + sizeof(Network::hidden2_biases)
+        + sizeof(Network::hidden2_weights) + sizeof(Network::output_bias) + sizeof(Network::output_weights);
+    FILE* file = fopen(path, "rb");
+    CHECK(file != nullptr);
+    fseek(file, 0, SEEK_END);
+    CHECK_EQUAL(static_cast<long>(expected_size), ftell(file));
+    fclose(file);
+
+    Nnue::InitRandom(2);
+    CHECK(Nnue::EvaluateFromScratch(bs) != expected);
+    CHECK(Nnue::Load(path));
+    CHECK_EQUAL(expected, Nnue::EvaluateFromScratch(bs));
+    remove(path);
+
+    CHECK(!Nnue::Load(path));
+    CHECK(Nnue::IsLoaded());
+}
+
+TEST(Nnue_Tests, Search)
+{
+    // The random network's scores are meaningless, so the quiescence search has little to cut
+    // off with. A quiet position keeps the search small.
+    BoardState bs("4k3/8/2p5/3p4/8/8/8/3QK3 w - - 0 1");
+    uint64_t key = bs.GetHashKey();
+    engine.SetHashSize(1);
+    CHECK(engine.SetEvaluator(Evaluator::Nnue));
+
+    SearchLimits limits;
+    limits.depth = 3;
+    engine.SetSearchLimits(limits);
+    SearchResult result = engine.RunSearch(bs);
+
+    CHECK(!result.best_move.IsNull());
+    CHECK_EQUAL(key, bs.GetHashKey());
+    CHECK(bs.GetAccumulators() == nullptr);
+
+    Nnue::Unload();
+    CHECK(engine.SetEvaluator(Evaluator::Classical));
+    CHECK(!engine.SetEvaluator(Evaluator::Nnue));
+}
@@ -0,0 +1,125 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/SimpleString.h"
+
+#include "pawn_structure.h"
+#include "board_state.h"
+#include "chess_engine.h"
+
+using Evaluation::Score;
+
+
+TEST_GROUP(PawnStructure_Tests)
+{
+    // Pawns on the given tiles, e.g. { "a2", "a3" }
+    uint64_t Pawns(std::initializer_list<const char*> tiles) {
+        uint64_t bits = 0;
+        for (const char* tile : tiles)
+            bits |= 1ULL << ((tile[1] - '1') * 8 + (tile[0] - 'a'));
+        return bits;
+    }
+
+    void CheckScore(Score expected, Score actual) {
+        CHECK_EQUAL(expected.mg, actual.mg);
+        CHECK_EQUAL(expected.eg, actual.eg);
+    }
+};
+
+TEST(PawnStructure_Tests, InitialPosition)
+{
+    CheckScore({ 0, 0 }, Evaluation::PawnStructureScore(Bitboard::initial_white_pawn_bits,
+        Bitboard::initial_white_pawn_bits << 40));
+}
+
+TEST(PawnStructure_Tests, DoubledIsolatedBlockedPassed)
+{
+    // The rear pawn is doubled and blocked, both are isolated, and only the front one is passed
+    Score expected = Evaluation::doubled_pawn_score + Evaluation::isolated_pawn_score
+        + Evaluation::isolated_pawn_score + Evaluation::blocked_pawn_score
+        + Evaluation::passed_pawn_scores[2];
+    CheckScore(expected, Evaluation::PawnStructureScore(Pawns({ "a2", "a3" }), 0));
+
+    // The same for black, on the mirrored tiles
+    CheckScore(-expected, Evaluation::PawnStructureScore(0, Pawns({ "a7", "a6" })));
+}
+
+TEST(PawnStructure_Tests, Backward)
+{
+    // d2 can't advance past e4's attack on d3, and c4 is too far ahead to defend it. c4 is
+    // passed, and e4 is isolated (but not also backward).
+    Score expected = Evaluation::backward_pawn_score + Evaluation::passed_pawn_scores[3]
+        - Evaluation::isolated_pawn_score;
+    CheckScore(expected, Evaluation::PawnStructureScore(Pawns({ "d2", "c4" }), Pawns({ "e4" })));
+
+    // With c2 instead, d2 can be defended on d3. (From c3 it couldn't.)
+    expected = Evaluation::passed_pawn_scores[1] - Evaluation::isolated_pawn_score;
+    CheckScore(expected, Evaluation::PawnStructureScore(Pawns({ "d2", "c2" }), Pawns({ "e4" })));
+}
+
+TEST(PawnStructure_Tests, Passed)
+{
+    // b5 and h6 are passed, but c5's path is covered by d6. h6 and d6 are both isolated.
+    Score expected = Evaluation::passed_pawn_scores[4] + Evaluation::passed_pawn_scores[5]
+        + Evaluation::isolated_pawn_score - Evaluation::isolated_pawn_score;
+    CheckScore(expected, Evaluation::PawnStructureScore(Pawns({ "b5", "c5", "h6" }), Pawns({ "d6" })));
+}
+
+TEST(PawnStructure_Tests, HashTable)
+{
+    PawnHashTable table(1000);
+    CHECK_EQUAL(512, table.GetNumEntries());
+
+    uint64_t white = Pawns({ "a2", "a3" });
+    Score score = Evaluation::PawnStructureScore(white, 0);
+    CheckScore(score, table.Probe(0x1234, white, 0));
+    CHECK_EQUAL(1, table.GetProbes());
+    CHECK_EQUAL(0, table.GetHits());
+
+    // A hit returns the stored score, without looking at the pawns
+    CheckScore(score, table.Probe(0x1234, 0, 0));
+    CHECK_EQUAL(2, table.GetProbes());
+    CHECK_EQUAL(1, table.GetHits());
+
+    // Same entry, different key: replaced
+    CheckScore({ 0, 0 }, table.Probe(0x1234 + 512, 0, 0));
+    CHECK_EQUAL(1, table.GetHits());
+
+    table.ResetCounts();
+    CHECK_EQUAL(0, table.GetProbes());
+    table.Clear();
+    CheckScore(score, table.Probe(0x1234 + 512, white, 0));
+    CHECK_EQUAL(0, table.GetHits());
+}
+
+TEST(PawnStructure_Tests, GetEvaluation)
+{
+    PawnHashTable table;
+
+    // The black pawns are the white ones mirrored, so the position scores 0 either way
+    BoardState bs("4k3/pp3p2/2p5/8/8/2P5/PP3P2/4K3 w - - 0 1");
+    CHECK_EQUAL(0, bs.GetEvaluation(table));
+
+    // With only kings and pawns the phase is 0, so the pawn terms add their endgame scores
+    BoardState doubled("4k3/pp3p2/2p5/8/8/2P5/P1P2P2/4K3 w - - 0 1");
+    Score pawn_score = Evaluation::PawnStructureScore(doubled.GetBitboards(Color::White).pawns.GetBits(),
+        doubled.GetBitboards(Color::Black).pawns.GetBits());
+    CHECK(pawn_score.eg < 0);
+    CHECK_EQUAL(doubled.GetEvaluation() + pawn_score.eg, doubled.GetEvaluation(table));
+}
+
+TEST(PawnStructure_Tests, SearchCountsProbes)
+{
+    ChessEngine engine;
+    SearchLimits limits;
+    limits.depth = 3;
+    engine.SetSearchLimits(limits);
+
+    BoardState bs("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    SearchResult result = engine.RunSearch(bs);
+    CHECK(result.pawn_hash_probes > 0);
+    CHECK(result.pawn_hash_hits > 0);
+    CHECK(result.pawn_hash_hits < result.pawn_hash_probes);
+
+    // The table is kept, so searching again finds more
+    SearchResult again = engine.RunSearch(bs);
+    CHECK(again.pawn_hash_hits * result.pawn_hash_probes > result.pawn_hash_hits * again.pawn_hash_probes);
+}
@@ -0,0 +1,175 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/SimpleString.h"
+
+#include "polyglot_book.h"
+#include "board_state.h"
+#include "chess_engine.h"
+
+#include <cstdio>
+#include <vector>
+
+
+TEST_GROUP(PolyglotBook_Tests)
+{
+    const char* path = "polyglot_book_tests.bin";
+    ChessEngine engine;
+    PolyglotBook book;
+
+    void teardown() {
+        book.Close();
+        remove(path);
+    }
+
+    // Polyglot move encoding of a move between two tiles given as text, e.g. "e2e4"
+    static uint16_t PolyglotMove(const char* text, unsigned promotion = 0) {
+        unsigned src = (text[1] - '1') * 8 + (text[0] - 'a');
+        unsigned dest = (text[3] - '1') * 8 + (text[2] - 'a');
+        return static_cast<uint16_t>(dest | (src << 6) | (promotion << 12));
+    }
+
+    // Writes the entries, which must be sorted by key, in big endian
+    void WriteBook(const std::vector<PolyglotBook::Entry>& entries) {
+        FILE* file = fopen(path, "wb");
+        for (const PolyglotBook::Entry& entry : entries) {
+            unsigned char bytes[PolyglotBook::entry_size];
+            for (int i = 0; i < 8; i++)
+                bytes[i] = static_cast<unsigned char>(entry.key >> (56 - 8 * i));
+            bytes[8] = entry.move >> 8;
+            bytes[9] = entry.move & 0xFF;
+            bytes[10] = entry.weight >> 8;
+            bytes[11] = entry.weight & 0xFF;
+            for (int i = 0; i < 4; i++)
+                bytes[12 + i] = static_cast<unsigned char>(entry.learn >> (24 - 8 * i));
+            fwrite(bytes, sizeof(bytes), 1, file);
+        }
+        fclose(file);
+    }
+};
+
+TEST(PolyglotBook_Tests, Open)
+{
+    CHECK_FALSE(book.Open("no_such_book.bin"));
+    CHECK_FALSE(book.IsOpen());
+
+    // Empty, and not a whole number of entries
+    WriteBook({});
+    CHECK_FALSE(book.Open(path));
+    FILE* file = fopen(path, "ab");
+    fputs("x", file);
+    fclose(file);
+    CHECK_FALSE(book.Open(path));
+
+    WriteBook({ { 1, 2, 3, 4 } });
+    CHECK(book.Open(path));
+    CHECK_EQUAL(1, book.Size());
+    PolyglotBook::Entry entry = book.GetEntry(0);
+    CHECK_EQUAL(1, entry.key);
+    CHECK_EQUAL(2, entry.move);
+    CHECK_EQUAL(3, entry.weight);
+    CHECK_EQUAL(4, entry.learn);
+
+    book.Close();
+    CHECK_FALSE(book.IsOpen());
+    CHECK_EQUAL(0, book.Size());
+}
+
+TEST(PolyglotBook_Tests, Probe)
+{
+    const uint64_t last_key = 0xFEDCBA9876543210ULL;
+    WriteBook({ { 1, 10, 1, 0 }, { 1, 11, 1, 0 }, { 5, 50, 1, 0 }, { 9, 90, 1, 0 }, { 9, 91, 1, 0 },
+        { 9, 92, 1, 0 }, { last_key, 100, 1, 0 } });
+    CHECK(book.Open(path));
+
+    std::vector<PolyglotBook::Entry> entries;
+    for (uint64_t key : { 0ULL, 3ULL, 6ULL, 10ULL, ~0ULL })
+        CHECK_EQUAL(0, book.Probe(key, entries));
+    CHECK(entries.empty());
+
+    CHECK_EQUAL(2, book.Probe(1, entries));
+    CHECK_EQUAL(1, book.Probe(5, entries));
+    CHECK_EQUAL(3, book.Probe(9, entries));
+    CHECK_EQUAL(1, book.Probe(last_key, entries));
+
+    // Appended in file order
+    const uint16_t moves[] = { 10, 11, 50, 90, 91, 92, 100 };
+    CHECK_EQUAL(7, entries.size());
+    for (size_t i = 0; i < entries.size(); i++)
+        CHECK_EQUAL(moves[i], entries[i].move);
+}
+
+TEST(PolyglotBook_Tests, DecodeMove)
+{
+    BoardState bs;
+    Move move = PolyglotBook::DecodeMove(engine, bs, PolyglotMove("e2e4"));
+    CHECK(Move(12, 28, Move::DoublePawnPush) == move);
+    CHECK(PolyglotBook::DecodeMove(engine, bs, PolyglotMove("e2e5")).IsNull());
+
+    // Castling is the king taking its own rook
+    BoardState castling("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+    CHECK(Move(4, 6, Move::KingCastle) == PolyglotBook::DecodeMove(engine, castling, PolyglotMove("e1h1")));
+    CHECK(Move(4, 2, Move::QueenCastle) == PolyglotBook::DecodeMove(engine, castling, PolyglotMove("e1a1")));
+
+    BoardState promotion("8/P7/8/8/8/8/8/k6K w - - 0 1");
+    move = PolyglotBook::DecodeMove(engine, promotion, PolyglotMove("a7a8", 1));
+    CHECK(move.IsPromotion());
+    CHECK(PieceType::Knight == move.GetPromotionType());
+    move = PolyglotBook::DecodeMove(engine, promotion, PolyglotMove("a7a8", 4));
+    CHECK(PieceType::Queen == move.GetPromotionType());
+}
+
+TEST(PolyglotBook_Tests, PickMove)
+{
+    // Picked by weight; never the illegal move or the one of weight 0
+    WriteBook({ { 7, PolyglotMove("e2e4"), 3, 0 }, { 7, PolyglotMove("e2e5"), 100, 0 },
+        { 7, PolyglotMove("g1f3"), 0, 0 }, { 7, PolyglotMove("d2d4"), 1, 0 } });
+    CHECK(book.Open(path));
+
+    BoardState bs;
+    unsigned e4_count = 0, d4_count = 0;
+    for (uint64_t random = 0; random < 400; random++) {
+        Move move = book.PickMove(engine, bs, 7, random);
+        e4_count += (move.GetSrcTileIndex() == 12 && move.GetDestTileIndex() == 28);
+        d4_count += (move.GetSrcTileIndex() == 11 && move.GetDestTileIndex() == 27);
+    }
+    CHECK_EQUAL(300, e4_count);
+    CHECK_EQUAL(100, d4_count);
+
+    CHECK(book.PickMove(engine, bs, 8, 0).IsNull());
+}
+
+// Test keys from the Polyglot book format document
+TEST(PolyglotBook_Tests, Key)
+{
+    BoardState bs;
+    CHECK_EQUAL(0x463B96181691FC9CULL, PolyglotBook::Key(bs));
+    bs.ApplyMove(Move(12, 28, Move::DoublePawnPush));
+    CHECK_EQUAL(0x823C9B50FD114196ULL, PolyglotBook::Key(bs));
+
+    // The en passant file counts when a pawn could capture (f6 here), and not otherwise (d6)
+    CHECK_EQUAL(0x0756B94461C50FB0ULL,
+        PolyglotBook::Key(BoardState("rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2")));
+    CHECK_EQUAL(0x22A48B5A8E47FF78ULL,
+        PolyglotBook::Key(BoardState("rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3")));
+
+    // Castling rights lost one side at a time
+    CHECK_EQUAL(0x00FDD303C946BDD9ULL,
+        PolyglotBook::Key(BoardState("rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4")));
+    CHECK_EQUAL(0x5C3F9B829B279560ULL,
+        PolyglotBook::Key(BoardState("rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4")));
+
+    // SelectMove plays the book move without searching
+    WriteBook({ { PolyglotBook::Key(BoardState()), PolyglotMove("d2d4"), 1, 0 } });
+    CHECK(engine.SetBook(path));
+    BoardState start;
+    Move move = engine.SelectMove(start);
+    CHECK(Move(11, 27, Move::DoublePawnPush) == move);
+    CHECK(engine.GetBookMove(start) == move);
+}
+
+TEST(PolyglotBook_Tests, NoBook)
+{
+    BoardState bs;
+    CHECK(engine.GetBookMove(bs).IsNull());
+    CHECK_FALSE(engine.SetBook("no_such_book.bin"));
+    CHECK(engine.GetBookMove(bs).IsNull());
+}
@@ -0,0 +1,183 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/SimpleString.h"
+
+#include "chess_engine.h"
+#include "search.h"
+#include "board_state.h"
+
+
+TEST_GROUP(Search_Tests)
+{
+    using Idx = TileName;
+
+    ChessEngine engine;
+
+    void setup() {
+        engine.SetHashSize(1);
+    }
+
+    SearchResult SearchToDepth(BoardState& bs, unsigned depth) {
+        SearchLimits limits;
+        limits.depth = depth;
+        engine.SetSearchLimits(limits);
+        return engine.RunSearch(bs);
+    }
+};
+
+TEST(Search_Tests, MateInOne)
+{
+    // Back rank mate. Black having no legal reply to Ra8 is found at the second ply.
+    BoardState bs("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+    SearchResult result = SearchToDepth(bs, 2);
+
+    CHECK(result.best_move == Move(TileIndex(Idx::A1), TileIndex(Idx::A8)));
+    CHECK_EQUAL(mate_score - 1, result.score);
+    CHECK(IsMateScore(result.score));
+}
+
+TEST(Search_Tests, WinsMaterial)
+{
+    // The knight on d5 can take the undefended queen on c7
+    BoardState bs("4k3/2q5/8/3N4/8/8/8/4K3 w - - 0 1");
+    SearchResult result = SearchToDepth(bs, 2);
+
+    CHECK(result.best_move == Move(TileIndex(Idx::D5), TileIndex(Idx::C7), Move::Capture));
+    CHECK(result.score > 250);       // Leaves white a knight up
+
+    // With black to move, the queen escapes and black stays a queen for a knight up
+    BoardState black("4k3/2q5/8/3N4/8/8/8/4K3 b - - 0 1");
+    result = SearchToDepth(black, 2);
+    CHECK(result.score > 500);
+}
+
+TEST(Search_Tests, Stalemate)
+{
+    // Qb6 stalemates, but any other queen move on the b file wins quickly
+    BoardState bs("k7/8/2K5/8/8/8/8/1Q6 w - - 0 1");
+    SearchResult result = SearchToDepth(bs, 2);
+    CHECK(result.best_move != Move(TileIndex(Idx::B1), TileIndex(Idx::B6)));
+    CHECK(result.score > 500);
+
+    // With no legal moves and no check, the position is a draw
+    BoardState stalemate("k7/8/1QK5/8/8/8/8/8 b - - 0 1");
+    result = SearchToDepth(stalemate, 3);
+    CHECK_EQUAL(0, result.score);
+    CHECK(result.best_move.IsNull());
+}
+
+TEST(Search_Tests, ResultAndBoardRestored)
+{
+    BoardState bs("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    uint64_t key = bs.GetHashKey();
+    SearchResult result = SearchToDepth(bs, 4);
+
+    CHECK_EQUAL(key, bs.GetHashKey());
+    CHECK(bs.GetPlayerToMove() == Color::White);
+    CHECK_EQUAL(4, result.depth);
+    CHECK(result.nodes > 0);
+    CHECK(!result.pv.empty());
+    CHECK(result.pv[0] == result.best_move);
+
+    // The PV is a sequence of moves which can be played from the position
+    MoveList moves;
+    for (Move move : result.pv) {
+        engine.GenerateMoves(bs, moves);
+        bool found = false;
+        for (Move m : moves)
+            found |= (m == move);
+        CHECK(found);
+        bs.ApplyMove(move);
+    }
+}
+
+TEST(Search_Tests, IterativeDeepening)
+{
+    BoardState bs("r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10");
+    SearchResult result = SearchToDepth(bs, 3);
+    CHECK_EQUAL(3, result.depth);
+
+    // Mates end the search once they're fully searched. The quiescence search finds that
+    // black has no evasion from Ra8, so this one is found at depth 1.
+    BoardState mate("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+    result = SearchToDepth(mate, 10);
+    CHECK_EQUAL(1, result.depth);
+    CHECK_EQUAL(mate_score - 1, result.score);
+}
+
+TEST(Search_Tests, NodeLimitIsDeterministic)
+{
+    const char* fen = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+    SearchLimits limits;
+    limits.depth = 0;
+    limits.nodes = 20000;
+
+    SearchResult results[2];
+    for (SearchResult& result : results) {
+        ChessEngine fresh_engine;
+        fresh_engine.SetHashSize(1);
+        fresh_engine.SetSearchLimits(limits);
+        BoardState bs(fen);
+        result = fresh_engine.RunSearch(bs);
+    }
+
+    CHECK(results[0].nodes <= limits.nodes);
+    CHECK(results[0].depth >= 1);
+    CHECK_EQUAL(results[0].nodes, results[1].nodes);
+    CHECK_EQUAL(results[0].depth, results[1].depth);
+    CHECK_EQUAL(results[0].score, results[1].score);
+    CHECK(results[0].best_move == results[1].best_move);
+}
+
+TEST(Search_Tests, TimeLimit)
+{
+    SearchLimits limits;
+    limits.depth = 0;
+    limits.seconds = 0.05;
+    engine.SetSearchLimits(limits);
+
+    BoardState bs("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    SearchResult result = engine.RunSearch(bs);
+
+    CHECK(result.seconds < 0.5);
+    CHECK(result.depth >= 1);
+    CHECK(!result.best_move.IsNull());
+}
+
+TEST(Search_Tests, Threads)
+{
+    BoardState bs("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    uint64_t key = bs.GetHashKey();
+
+    engine.SetThreads(4);
+    SearchResult result = SearchToDepth(bs, 4);
+
+    // The main thread's board is untouched by the helpers
+    CHECK_EQUAL(key, bs.GetHashKey());
+    CHECK_EQUAL(4, result.depth);
+    CHECK(!result.best_move.IsNull());
+    CHECK(result.pv[0] == result.best_move);
+}
+
+TEST(Search_Tests, Quiescence)
+{
+    // Qxd5 wins a pawn at depth 1, until the quiescence search sees cxd5 losing the queen
+    BoardState bs("4k3/8/2p5/3p4/8/8/8/3QK3 w - - 0 1");
+    SearchResult result = SearchToDepth(bs, 1);
+    CHECK(result.best_move != Move(TileIndex(Idx::D1), TileIndex(Idx::D5), Move::Capture));
+    CHECK(result.score > 500);
+
+    // An undefended pawn is still taken
+    BoardState undefended("4k3/8/8/3p4/8/8/8/3QK3 w - - 0 1");
+    result = SearchToDepth(undefended, 1);
+    CHECK(result.best_move == Move(TileIndex(Idx::D1), TileIndex(Idx::D5), Move::Capture));
+}
+
+TEST(Search_Tests, QuiescenceCheckEvasions)
+{
+    // Rxf1 wins a rook at depth 1, but leaves g7 undefended: Qxg7 is mate, found only by the
+    // quiescence search, which must search the evasions (there are none) rather than stand pat
+    BoardState bs("7k/5rpp/8/8/8/6Q1/1B5K/5R2 b - - 0 1");
+    SearchResult result = SearchToDepth(bs, 1);
+    CHECK(result.best_move != Move(TileIndex(Idx::F7), TileIndex(Idx::F1), Move::Capture));
+    CHECK_FALSE(IsMateScore(result.score));
+}
@@ -1,11 +1,45 @@
 #include <sstream>
 #include <iomanip>
 #include <iostream>
+#include <vector>
 #include "CppUTest/SimpleString.h"
 #include "bitboard.h"
+#include "board_state.h"
+#include "chess_engine.h"
+#include "random.h"
 
 inline SimpleString StringFrom(Bitboard b) {
     std::stringstream sstream;
     sstream << b;
     return StringFrom(sstream.str());
-}
\ No newline at end of file
+}
+
+// The moves of a pseudo-random game from fen: up to plies of them, or fewer if the game ends.
+// The same seed always gives the same game.
+inline std::vector<Move> RandomGameMoves(const char* fen, int plies, uint64_t seed = 0x9E3779B97F4A7C15ULL) {
+    ChessEngine engine;
+    BoardState bs(fen);
+    MoveList moves;
+    std::vector<Move> played;
+
+    for (int ply = 0; ply < plies; ply++) {
+        engine.GenerateMoves(bs, moves);
+        if (moves.Size() == 0)
+            break;
+        played.push_back(moves[(XorShift64Star(seed) >> 32) % moves.Size()]);
+        bs.ApplyMove(played.back());
+    }
+    return played;
+}
+
+// The positions after each move of the same game
+inline std::vector<BoardState> RandomGamePositions(const char* fen, int plies,
+        uint64_t seed = 0x9E3779B97F4A7C15ULL) {
+    BoardState bs(fen);
+    std::vector<BoardState> positions;
+    for (Move move : RandomGameMoves(fen, plies, seed)) {
+        bs.ApplyMove(move);
+        positions.push_back(bs);
+    }
+    return positions;
+}
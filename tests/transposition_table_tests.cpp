@@ -0,0 +1,115 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/SimpleString.h"
+
+// So we can check the value of private members
+#define private public
+#include "transposition_table.h"
+#undef private
+
+
+TEST_GROUP(TranspositionTable_Tests)
+{
+    using Bound = TranspositionTable::Bound;
+
+    TranspositionTable tt{1};
+
+    // Keys which all map to the first bucket
+    uint64_t BucketZeroKey(unsigned i) {
+        return (static_cast<uint64_t>(i) + 1) * tt.num_buckets_;
+    }
+};
+
+TEST(TranspositionTable_Tests, Size)
+{
+    CHECK_EQUAL(1024 * 1024, tt.GetSizeBytes());
+    CHECK_EQUAL(64, sizeof(TranspositionTable::Bucket));
+
+    // Rounded down to a power of two buckets
+    tt.Resize(3);
+    CHECK_EQUAL(2 * 1024 * 1024, tt.GetSizeBytes());
+
+    tt.Resize(0);
+    CHECK_EQUAL(64, tt.GetSizeBytes());
+}
+
+TEST(TranspositionTable_Tests, StoreAndProbe)
+{
+    uint64_t key = 0x123456789ABCDEF0ULL;
+    Move move(12, 28, Move::DoublePawnPush);
+    TranspositionTable::Entry entry;
+
+    CHECK_FALSE(tt.Probe(key, entry));
+
+    tt.Store(key, move, -1234, 7, Bound::Lower);
+    CHECK(tt.Probe(key, entry));
+    CHECK(entry.move == move);
+    CHECK_EQUAL(-1234, entry.score);
+    CHECK_EQUAL(7, entry.depth);
+    CHECK(entry.bound == Bound::Lower);
+
+    // Same bucket, different key
+    CHECK_FALSE(tt.Probe(key ^ (1ULL << 63), entry));
+
+    // A null move keeps the stored move
+    tt.Store(key, Move(), 50, 8, Bound::Exact);
+    CHECK(tt.Probe(key, entry));
+    CHECK(entry.move == move);
+    CHECK_EQUAL(50, entry.score);
+
+    tt.Clear();
+    CHECK_FALSE(tt.Probe(key, entry));
+}
+
+TEST(TranspositionTable_Tests, TornEntryIsAMiss)
+{
+    uint64_t key = 0xFEDCBA9876543210ULL;
+    TranspositionTable::Entry entry;
+    tt.Store(key, Move(1, 2), 10, 3, Bound::Exact);
+
+    // As if another thread had written the data word, but not yet the key word
+    TranspositionTable::Slot* slot = nullptr;
+    for (auto& s : tt.GetBucket(key).slots) {
+        if ((s.key_xor_data ^ s.data) == key)
+            slot = &s;
+    }
+    CHECK(slot != nullptr);
+    slot->data.store(TranspositionTable::Pack(Move(3, 4), 20, 5, Bound::Exact, 0));
+
+    CHECK_FALSE(tt.Probe(key, entry));
+}
+
+TEST(TranspositionTable_Tests, ReplacesShallowest)
+{
+    TranspositionTable::Entry entry;
+    for (unsigned i = 0; i < TranspositionTable::entries_per_bucket; i++)
+        tt.Store(BucketZeroKey(i), Move(1, 2), 0, 10 + i, Bound::Exact);
+
+    // The full bucket loses its shallowest entry (the first one stored)
+    tt.Store(BucketZeroKey(10), Move(1, 2), 0, 5, Bound::Exact);
+    CHECK(tt.Probe(BucketZeroKey(10), entry));
+    CHECK_FALSE(tt.Probe(BucketZeroKey(0), entry));
+    for (unsigned i = 1; i < TranspositionTable::entries_per_bucket; i++)
+        CHECK(tt.Probe(BucketZeroKey(i), entry));
+
+    // Entries from an earlier search are replaced before deeper ones from this search
+    tt.NewSearch();
+    tt.Store(BucketZeroKey(11), Move(1, 2), 0, 4, Bound::Exact);
+    tt.Store(BucketZeroKey(12), Move(1, 2), 0, 4, Bound::Exact);
+    CHECK(tt.Probe(BucketZeroKey(11), entry));
+    CHECK(tt.Probe(BucketZeroKey(12), entry));
+    CHECK_FALSE(tt.Probe(BucketZeroKey(10), entry));
+    CHECK_FALSE(tt.Probe(BucketZeroKey(1), entry));
+}
+
+TEST(TranspositionTable_Tests, Hashfull)
+{
+    CHECK_EQUAL(0, tt.GetHashfull());
+
+    // The first 250 buckets are sampled
+    for (uint64_t key = 0; key < 125; key++)
+        tt.Store(key, Move(1, 2), 0, 1, Bound::Exact);
+    CHECK_EQUAL(125, tt.GetHashfull());
+
+    tt.NewSearch();
+    CHECK_EQUAL(0, tt.GetHashfull());
+}
@@ -0,0 +1,296 @@
+// Search benchmark: searches a fixed set of positions to a fixed depth or node count, and
+// reports the nodes searched, time taken and nodes per second. Move generation speed is
+// measured by perft.
+//
+// Usage:
+//   bench [depth] [hash_mb]                    Search each position to the given depth
+//   bench nodes <count> [hash_mb]              Search each position for a fixed number of nodes.
+//                                              The results are the same on any machine; only
+//                                              the time differs.
+//   bench threads <max> [depth] [hash_mb]      Search to the given depth with 1, 2, 4... up to
+//                                              max threads, and compare nodes per second and
+//                                              time to depth with the single threaded search
+//   bench fen [iterations]                     Parse and write the FEN of each position the given
+//                                              number of times, and report characters per second
+//   bench eval [positions] [iterations]        Evaluate positions from pseudo-random games one
+//                                              BoardState at a time, and in batches with each
+//                                              batch evaluation backend
+//   bench nnue <file|random> [nodes] [hash_mb] Search each position for a fixed number of nodes
+//                                              with the classical evaluation, then with the NNUE
+//                                              network in file (or a random one) and each NNUE
+//                                              backend, and compare nodes per second
+
+#include "batch_evaluation.h"
+#include "board_state.h"
+#include "chess_engine.h"
+#include "nnue.h"
+#include "random.h"
+#include "terminal.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const kBenchFens[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+
+struct BenchTotals {
+    uint64_t nodes = 0;
+    double seconds = 0;
+    uint64_t pawn_hash_probes = 0;
+    uint64_t pawn_hash_hits = 0;
+};
+
+BenchTotals RunBench(const SearchLimits& limits, unsigned threads, size_t hash_mb, bool print_results,
+                     Evaluator evaluator = Evaluator::Classical) {
+    BenchTotals totals;
+
+    for (const char* fen : kBenchFens) {
+        // A fresh engine per position, so that results don't depend on the order searched
+        ChessEngine engine;
+        engine.SetHashSize(hash_mb);
+        engine.SetSearchLimits(limits);
+        engine.SetThreads(threads);
+        engine.SetEvaluator(evaluator);
+
+        BoardState bs(fen);
+        SearchResult result = engine.RunSearch(bs);
+        totals.nodes += result.nodes;
+        totals.seconds += result.seconds;
+        totals.pawn_hash_probes += result.pawn_hash_probes;
+        totals.pawn_hash_hits += result.pawn_hash_hits;
+
+        if (print_results) {
+            printf("%s\n  ", fen);
+            Terminal().PrintSearchResult(result);
+        }
+    }
+    return totals;
+}
+
+double Nps(const BenchTotals& totals) {
+    return totals.seconds > 0 ? totals.nodes / totals.seconds : 0.0;
+}
+
+int RunScaling(unsigned max_threads, const SearchLimits& limits, size_t hash_mb) {
+    std::vector<unsigned> thread_counts;
+    for (unsigned threads = 1; threads < max_threads; threads *= 2)
+        thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads);
+
+    BenchTotals single;
+    printf("%7s %12s %9s %12s %11s %11s\n", "Threads", "Nodes", "Time s", "NPS", "NPS x", "Speedup x");
+    for (unsigned threads : thread_counts) {
+        BenchTotals totals = RunBench(limits, threads, hash_mb, false);
+        if (threads == 1)
+            single = totals;
+
+        // Speedup is time to depth, relative to one thread
+        printf("%7u %12llu %9.3f %12.0f %11.2f %11.2f\n", threads, (unsigned long long)totals.nodes,
+            totals.seconds, Nps(totals), Nps(single) > 0 ? Nps(totals) / Nps(single) : 0.0,
+            totals.seconds > 0 ? single.seconds / totals.seconds : 0.0);
+    }
+    return 0;
+}
+
+int RunFenBench(unsigned iterations) {
+    using Clock = std::chrono::steady_clock;
+    size_t chars = 0;
+    for (const char* fen : kBenchFens)
+        chars += strlen(fen);
+    chars *= iterations;
+
+    // The checksums keep the work from being optimized away
+    uint64_t checksum = 0;
+    Clock::time_point start = Clock::now();
+    for (unsigned i = 0; i < iterations; i++) {
+        for (const char* fen : kBenchFens)
+            checksum += BoardState(fen).GetHashKey();
+    }
+    double parse_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<BoardState> positions(kBenchFens, kBenchFens + sizeof(kBenchFens) / sizeof(kBenchFens[0]));
+    char buffer[BoardState::max_fen_length + 1];
+    start = Clock::now();
+    for (unsigned i = 0; i < iterations; i++) {
+        for (const BoardState& bs : positions)
+            checksum += bs.WriteFen(buffer) + buffer[i % 8];
+    }
+    double write_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    printf("%6s %12s %9s %14s %14s\n", "", "Characters", "Time s", "Chars/s", "FENs/s");
+    printf("%6s %12zu %9.3f %14.0f %14.0f\n", "Parse", chars, parse_seconds, chars / parse_seconds,
+        iterations * positions.size() / parse_seconds);
+    printf("%6s %12zu %9.3f %14.0f %14.0f\n", "Write", chars, write_seconds, chars / write_seconds,
+        iterations * positions.size() / write_seconds);
+    printf("(checksum %llu)\n", (unsigned long long)checksum);
+    return 0;
+}
+
+// Positions along pseudo-random games from the bench positions
+std::vector<BoardState> RandomPositions(size_t count) {
+    ChessEngine engine;
+    std::vector<BoardState> positions;
+    MoveList moves;
+    uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+    while (positions.size() < count) {
+        for (const char* fen : kBenchFens) {
+            BoardState bs(fen);
+            for (int ply = 0; ply < 200 && positions.size() < count; ply++) {
+                engine.GenerateMoves(bs, moves);
+                if (moves.Size() == 0)
+                    break;
+                bs.ApplyMove(moves[(XorShift64Star(rng_state) >> 32) % moves.Size()]);
+                positions.push_back(bs);
+            }
+        }
+    }
+    return positions;
+}
+
+int RunEvalBench(size_t count, unsigned iterations) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<BoardState> positions = RandomPositions(count);
+    Evaluation::PositionBatch batch;
+    batch.Reserve(count);
+    for (const BoardState& bs : positions)
+        batch.Add(bs);
+    std::vector<int> scores(count);
+
+    printf("%-26s %14s\n", "", "Positions/s");
+    auto report = [&](const char* name, Clock::time_point start, int64_t checksum) {
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        printf("%-26s %14.0f   (checksum %lld)\n", name, count * iterations / seconds, (long long)checksum);
+    };
+
+    // GetEvaluation just reads the incrementally updated score
+    int64_t checksum = 0;
+    Clock::time_point start = Clock::now();
+    for (unsigned i = 0; i < iterations; i++) {
+        for (const BoardState& bs : positions)
+            checksum += bs.GetEvaluation();
+    }
+    report("BoardState::GetEvaluation", start, checksum);
+
+    // Scoring bitboards one at a time means building a BoardState from them first
+    checksum = 0;
+    start = Clock::now();
+    for (unsigned i = 0; i < iterations; i++) {
+        for (size_t p = 0; p < count; p++) {
+            BoardState bs("");
+            for (Color color : { Color::Black, Color::White }) {
+                for (int type = 0; type < 6; type++) {
+                    Bitboard pieces(batch.Pieces(color, static_cast<PieceType>(type))[p]);
+                    while (pieces.GetBits()) {
+                        unsigned index = pieces.BitscanForward();
+                        pieces.BitClear(index);
+                        bs.SetTile(index, TileContents(color, static_cast<PieceType>(type)));
+                    }
+                }
+            }
+            checksum += bs.GetEvaluation();
+        }
+    }
+    report("BoardState from bitboards", start, checksum);
+
+    for (Evaluation::BatchBackend backend : { Evaluation::BatchBackend::Scalar, Evaluation::BatchBackend::Avx2 }) {
+        std::string name = std::string("EvaluateBatch ") + Evaluation::BatchBackendName(backend);
+        if (backend == Evaluation::BatchBackend::Avx2 && !Evaluation::Avx2Supported()) {
+            printf("%-26s %14s\n", name.c_str(), "unsupported");
+            continue;
+        }
+
+        checksum = 0;
+        start = Clock::now();
+        for (unsigned i = 0; i < iterations; i++) {
+            Evaluation::EvaluateBatch(batch, scores.data(), backend);
+            for (int score : scores)
+                checksum += score;
+        }
+        report(name.c_str(), start, checksum);
+    }
+    return 0;
+}
+
+int RunNnueBench(const char* path, const SearchLimits& limits, size_t hash_mb) {
+    if (strcmp(path, "random") == 0) {
+        Nnue::InitRandom(1);
+    } else if (!Nnue::Load(path)) {
+        fprintf(stderr, "Can't load network: %s\n", path);
+        return 1;
+    }
+
+    // With the same node limit, the two evaluators search different trees, so the node
+    // counts (and times) differ as well as the nodes per second. A random network knows
+    // nothing of material, so the first iteration, which isn't cut short by the node limit,
+    // searches far more captures than it would with a trained one.
+    printf("%-16s %12s %9s %12s\n", "Evaluator", "Nodes", "Time s", "NPS");
+    BenchTotals totals = RunBench(limits, 1, hash_mb, false, Evaluator::Classical);
+    printf("%-16s %12llu %9.3f %12.0f\n", "classical", (unsigned long long)totals.nodes, totals.seconds, Nps(totals));
+
+    Nnue::Backend default_backend = Nnue::GetBackend();
+    for (Nnue::Backend backend : { Nnue::Backend::Scalar, Nnue::Backend::Sse, Nnue::Backend::Avx2 }) {
+        std::string name = std::string("nnue ") + Nnue::BackendName(backend);
+        if (!Nnue::SetBackend(backend)) {
+            printf("%-16s %12s\n", name.c_str(), "unsupported");
+            continue;
+        }
+        totals = RunBench(limits, 1, hash_mb, false, Evaluator::Nnue);
+        printf("%-16s %12llu %9.3f %12.0f\n", name.c_str(), (unsigned long long)totals.nodes, totals.seconds, Nps(totals));
+    }
+    Nnue::SetBackend(default_backend);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    SearchLimits limits;
+    limits.depth = 5;
+    int hash_arg = 2;
+
+    if (argc > 2 && strcmp(argv[1], "nodes") == 0) {
+        limits.depth = 0;
+        limits.nodes = strtoull(argv[2], nullptr, 10);
+        hash_arg = 3;
+    } else if (argc > 2 && strcmp(argv[1], "threads") == 0) {
+        unsigned max_threads = strtoul(argv[2], nullptr, 10);
+        if (argc > 3)
+            limits.depth = strtoul(argv[3], nullptr, 10);
+        size_t hash_mb = (argc > 4) ? strtoul(argv[4], nullptr, 10) : ChessEngine::default_hash_size_mb;
+        return RunScaling(max_threads ? max_threads : 1, limits, hash_mb);
+    } else if (argc > 1 && strcmp(argv[1], "eval") == 0) {
+        size_t count = (argc > 2) ? strtoul(argv[2], nullptr, 10) : 100000;
+        return RunEvalBench(count ? count : 1, (argc > 3) ? strtoul(argv[3], nullptr, 10) : 100);
+    } else if (argc > 2 && strcmp(argv[1], "nnue") == 0) {
+        limits.depth = 0;
+        limits.nodes = (argc > 3) ? strtoull(argv[3], nullptr, 10) : 200000;
+        size_t hash_mb = (argc > 4) ? strtoul(argv[4], nullptr, 10) : ChessEngine::default_hash_size_mb;
+        return RunNnueBench(argv[2], limits, hash_mb);
+    } else if (argc > 1 && strcmp(argv[1], "fen") == 0) {
+        return RunFenBench((argc > 2) ? strtoul(argv[2], nullptr, 10) : 1000000);
+    } else if (argc > 1) {
+        limits.depth = strtoul(argv[1], nullptr, 10);
+    }
+    size_t hash_mb = (argc > hash_arg) ? strtoul(argv[hash_arg], nullptr, 10) : ChessEngine::default_hash_size_mb;
+
+    BenchTotals totals = RunBench(limits, 1, hash_mb, true);
+    printf("\nNodes: %llu\n", (unsigned long long)totals.nodes);
+    printf("Time:  %.3f s\n", totals.seconds);
+    printf("NPS:   %.0f\n", Nps(totals));
+    if (totals.pawn_hash_probes)
+        printf("Pawn hash hits: %.1f%%\n", 100.0 * totals.pawn_hash_hits / totals.pawn_hash_probes);
+    return 0;
+}
@@ -0,0 +1,61 @@
+// Bitbase generator: solves the KQK, KRK and KPK endgames by retrograde analysis (see
+// bitbase.h), and writes their files, for main --bitbases to load.
+//
+// Usage:
+//   gen_bitbase [directory] [threads]  Write kqk.bin, krk.bin and kpk.bin to directory (the
+//                                      current one by default), using the given number of
+//                                      threads (by default, one per core). Reports the time
+//                                      taken and the number of won positions for each.
+
+#include "bitbase.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Won positions with the strong side to move, and with the weak side to move
+void CountWins(const std::vector<uint8_t>& bits, uint32_t& strong_to_move, uint32_t& weak_to_move) {
+    strong_to_move = weak_to_move = 0;
+    for (uint32_t i = 0; i < Bitbase::num_positions; i++) {
+        if ((bits[i >> 3] >> (i & 7)) & 1)
+            ((i & 1) ? strong_to_move : weak_to_move)++;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    using Clock = std::chrono::steady_clock;
+    std::string directory = (argc > 1) ? argv[1] : ".";
+    unsigned threads = (argc > 2) ? strtoul(argv[2], nullptr, 10) : std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+
+    // KPK promotes into the other two, so they're generated first
+    std::vector<uint8_t> results[Bitbase::num_endgames];
+    printf("%-8s %9s %14s %14s\n", "File", "Time s", "Wins (strong)", "Wins (weak)");
+    for (Bitbase::Endgame endgame : { Bitbase::Endgame::Kqk, Bitbase::Endgame::Krk, Bitbase::Endgame::Kpk }) {
+        Clock::time_point start = Clock::now();
+        std::vector<uint8_t>& bits = results[static_cast<int>(endgame)];
+        bits = Bitbase::Generate(endgame, threads, &results[static_cast<int>(Bitbase::Endgame::Kqk)],
+            &results[static_cast<int>(Bitbase::Endgame::Krk)]);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::string path = directory + "/" + Bitbase::FileName(endgame);
+        if (!Bitbase::Save(bits, path.c_str())) {
+            fprintf(stderr, "Can't write %s\n", path.c_str());
+            return 1;
+        }
+
+        uint32_t strong_wins, weak_wins;
+        CountWins(bits, strong_wins, weak_wins);
+        printf("%-8s %9.3f %14u %14u\n", Bitbase::FileName(endgame), seconds, strong_wins, weak_wins);
+    }
+    printf("(%u threads)\n", threads);
+    return 0;
+}
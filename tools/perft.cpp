@@ -0,0 +1,247 @@
+// Perft (performance test) tool: counts the leaf nodes of the move tree from a position, to
+// validate move generation against known results and to measure its speed.
+//
+// Usage:
+//   perft <depth> [fen]        Per-move node counts (divide), total nodes and nodes per second
+//   perft suite [max_depth]    Check the reference positions below against their known counts
+//   perft compare [max_depth]  Compare make/unmake against copy-make, and legal generation against
+//                              pseudo-legal generation plus a legality filter, over the reference
+//                              positions
+//   perft backends [max_depth] Time the reference positions with each slider attack backend
+//                              (magic bitboards, PEXT) that this build and CPU support
+
+#include "attacks.h"
+#include "board_state.h"
+#include "chess_engine.h"
+#include "terminal.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const kStartFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Known results from https://www.chessprogramming.org/Perft_Results
+struct ReferencePosition {
+    const char* name;
+    const char* fen;
+    std::vector<uint64_t> nodes;    // nodes[i] is the node count at depth i + 1
+};
+
+const std::vector<ReferencePosition> kReferencePositions = {
+    { "Initial position", kStartFen,
+        { 20, 400, 8902, 197281, 4865609, 119060324 } },
+    { "Kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        { 48, 2039, 97862, 4085603, 193690690 } },
+    { "Position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        { 14, 191, 2812, 43238, 674624, 11030083 } },
+    { "Position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        { 6, 264, 9467, 422333, 15833292 } },
+    { "Position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        { 44, 1486, 62379, 2103487, 89941194 } },
+    { "Position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        { 46, 2079, 89890, 3894594, 164075551 } },
+};
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void PrintUsage() {
+    puts("Usage:");
+    puts("  perft <depth> [fen]        Per-move node counts, total nodes and nodes per second");
+    puts("  perft suite [max_depth]    Check the reference positions against their known counts");
+    puts("  perft compare [max_depth]  Compare make/unmake against copy-make, and legal against");
+    puts("                             pseudo-legal generation plus a legality filter");
+    puts("  perft backends [max_depth] Time the reference positions with each slider attack backend");
+}
+
+int RunDivide(unsigned depth, const std::string& fen) {
+    ChessEngine engine;
+    BoardState bs(fen);
+
+    auto start = Clock::now();
+    uint64_t total = 0;
+
+    MoveList moves;
+    engine.GenerateMoves(bs, moves);
+    UndoRecord undo;
+    for (Move move : moves) {
+        bs.ApplyMove(move, undo);
+        uint64_t nodes = (depth > 1) ? engine.Perft(bs, depth - 1) : 1;
+        bs.UndoMove(move, undo);
+        printf("%s: %llu\n", Terminal::MoveToText(move).c_str(), (unsigned long long)nodes);
+        total += nodes;
+    }
+
+    double seconds = SecondsSince(start);
+    printf("\nMoves: %u\n", moves.Size());
+    printf("Nodes: %llu\n", (unsigned long long)total);
+    printf("Time:  %.3f s\n", seconds);
+    printf("NPS:   %.0f\n", seconds > 0 ? total / seconds : 0.0);
+    return 0;
+}
+
+int RunSuite(unsigned max_depth) {
+    ChessEngine engine;
+    uint64_t total_nodes = 0;
+    double total_seconds = 0;
+    int failures = 0;
+
+    for (const ReferencePosition& ref : kReferencePositions) {
+        printf("%s: %s\n", ref.name, ref.fen);
+        BoardState bs(ref.fen);
+
+        for (unsigned depth = 1; depth <= max_depth && depth <= ref.nodes.size(); depth++) {
+            auto start = Clock::now();
+            uint64_t nodes = engine.Perft(bs, depth);
+            double seconds = SecondsSince(start);
+            total_nodes += nodes;
+            total_seconds += seconds;
+
+            uint64_t expected = ref.nodes[depth - 1];
+            bool pass = (nodes == expected);
+            failures += !pass;
+            printf("  depth %u: %12llu  expected %12llu  %s  %8.3f s\n", depth,
+                (unsigned long long)nodes, (unsigned long long)expected, pass ? "PASS" : "FAIL", seconds);
+        }
+    }
+
+    printf("\nNodes: %llu\n", (unsigned long long)total_nodes);
+    printf("Time:  %.3f s\n", total_seconds);
+    printf("NPS:   %.0f\n", total_seconds > 0 ? total_nodes / total_seconds : 0.0);
+    printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
+
+// Runs both tree walking strategies, and the pseudo-legal generator with a legality filter, over
+// the reference positions. Depth 1 is skipped, since it doesn't apply any moves.
+int RunCompare(unsigned max_depth) {
+    ChessEngine engine;
+    uint64_t total_nodes = 0;
+    double make_unmake_seconds = 0;
+    double copy_make_seconds = 0;
+    double pseudo_legal_seconds = 0;
+    int mismatches = 0;
+
+    printf("%-18s %5s %12s %14s %14s %16s\n", "Position", "Depth", "Nodes", "Make/unmake s", "Copy-make s",
+        "Pseudo+filter s");
+    for (const ReferencePosition& ref : kReferencePositions) {
+        BoardState bs(ref.fen);
+
+        for (unsigned depth = 2; depth <= max_depth && depth <= ref.nodes.size(); depth++) {
+            auto start = Clock::now();
+            uint64_t nodes = engine.Perft(bs, depth);
+            double make_unmake = SecondsSince(start);
+
+            start = Clock::now();
+            uint64_t copy_make_nodes = engine.PerftCopyMake(bs, depth);
+            double copy_make = SecondsSince(start);
+
+            start = Clock::now();
+            uint64_t pseudo_legal_nodes = engine.PerftPseudoLegal(bs, depth);
+            double pseudo_legal = SecondsSince(start);
+
+            mismatches += (nodes != copy_make_nodes) + (nodes != pseudo_legal_nodes);
+            total_nodes += nodes;
+            make_unmake_seconds += make_unmake;
+            copy_make_seconds += copy_make;
+            pseudo_legal_seconds += pseudo_legal;
+            printf("%-18s %5u %12llu %14.3f %14.3f %16.3f\n", ref.name, depth, (unsigned long long)nodes,
+                make_unmake, copy_make, pseudo_legal);
+        }
+    }
+
+    printf("\nMake/unmake NPS:   %.0f\n", make_unmake_seconds > 0 ? total_nodes / make_unmake_seconds : 0.0);
+    printf("Copy-make NPS:     %.0f\n", copy_make_seconds > 0 ? total_nodes / copy_make_seconds : 0.0);
+    printf("Pseudo+filter NPS: %.0f\n", pseudo_legal_seconds > 0 ? total_nodes / pseudo_legal_seconds : 0.0);
+    if (mismatches)
+        printf("FAILED: node counts differ between strategies (%d)\n", mismatches);
+    return mismatches ? 1 : 0;
+}
+
+// The counts are checked too, since a backend that's fast but wrong is no use
+int RunBackends(unsigned max_depth) {
+    ChessEngine engine;
+    Attacks::Backend initial = Attacks::GetBackend();
+    int failures = 0;
+
+    printf("Default backend: %s\n\n", Attacks::BackendName(initial));
+    printf("%-8s %12s %9s %12s\n", "Backend", "Nodes", "Time s", "NPS");
+    for (Attacks::Backend backend : { Attacks::Backend::Magic, Attacks::Backend::Pext }) {
+        if (!Attacks::SetBackend(backend)) {
+            printf("%-8s not supported\n", Attacks::BackendName(backend));
+            continue;
+        }
+
+        uint64_t total_nodes = 0;
+        double total_seconds = 0;
+        for (const ReferencePosition& ref : kReferencePositions) {
+            BoardState bs(ref.fen);
+            unsigned depth = (max_depth < ref.nodes.size()) ? max_depth : ref.nodes.size();
+
+            auto start = Clock::now();
+            uint64_t nodes = engine.Perft(bs, depth);
+            total_seconds += SecondsSince(start);
+            total_nodes += nodes;
+            failures += (nodes != ref.nodes[depth - 1]);
+        }
+        printf("%-8s %12llu %9.3f %12.0f\n", Attacks::BackendName(backend), (unsigned long long)total_nodes,
+            total_seconds, total_seconds > 0 ? total_nodes / total_seconds : 0.0);
+    }
+
+    Attacks::SetBackend(initial);
+    if (failures)
+        printf("FAILED: wrong node counts (%d)\n", failures);
+    return failures ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        PrintUsage();
+        return 2;
+    }
+
+    try {
+        std::string command = argv[1];
+        if (command == "suite") {
+            unsigned max_depth = (argc > 2) ? strtoul(argv[2], nullptr, 10) : 4;
+            return RunSuite(max_depth);
+        }
+        if (command == "compare") {
+            unsigned max_depth = (argc > 2) ? strtoul(argv[2], nullptr, 10) : 4;
+            return RunCompare(max_depth);
+        }
+        if (command == "backends") {
+            unsigned max_depth = (argc > 2) ? strtoul(argv[2], nullptr, 10) : 5;
+            return RunBackends(max_depth ? max_depth : 1);
+        }
+
+        unsigned depth = strtoul(argv[1], nullptr, 10);
+        if (depth == 0) {
+            PrintUsage();
+            return 2;
+        }
+
+        std::string fen = kStartFen;
+        if (argc > 2) {
+            // Allow the FEN to be passed unquoted, as separate arguments
+            fen = argv[2];
+            for (int i = 3; i < argc; i++)
+                fen += std::string(" ") + argv[i];
+        }
+        return RunDivide(depth, fen);
+    } catch (const std::invalid_argument& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 2;
+    }
+}